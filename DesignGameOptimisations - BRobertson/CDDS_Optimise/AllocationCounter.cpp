@@ -0,0 +1,103 @@
+#include "AllocationCounter.h"
+
+#if defined(COUNT_HEAP_ALLOCATIONS)
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace
+{
+    std::atomic<size_t> g_heapAllocations{ 0 };
+
+    void* CountedAllocate(size_t size)
+    {
+        g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        if (void* memory = std::malloc(size > 0 ? size : 1))
+            return memory;
+        throw std::bad_alloc();
+    }
+
+#if defined(__cpp_aligned_new)
+    // Over-aligned blocks need the platform's aligned allocator, and must go back through its matching free
+    void* CountedAllocateAligned(size_t size, std::align_val_t alignment) noexcept
+    {
+        g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        const size_t align = static_cast<size_t>(alignment);
+#if defined(_MSC_VER)
+        return _aligned_malloc(size > 0 ? size : 1, align);
+#else
+        void* memory = nullptr;
+        if (posix_memalign(&memory, align > sizeof(void*) ? align : sizeof(void*), size > 0 ? size : 1) != 0)
+            return nullptr;
+        return memory;
+#endif
+    }
+
+    void FreeAligned(void* memory) noexcept
+    {
+#if defined(_MSC_VER)
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+#endif
+}
+
+size_t GetHeapAllocationCount()
+{
+    return g_heapAllocations.load(std::memory_order_relaxed);
+}
+
+// Replacements for the global allocation functions.  The plain and nothrow forms share malloc/free;
+// the std::align_val_t forms (C++17 and later) share the aligned allocator above.
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+#if defined(__cpp_aligned_new)
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (void* memory = CountedAllocateAligned(size, alignment))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return CountedAllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return CountedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(memory); }
+#endif
+#endif
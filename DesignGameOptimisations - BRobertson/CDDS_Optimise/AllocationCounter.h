@@ -0,0 +1,10 @@
+#pragma once
+#include <cstddef>
+
+// Counts calls to the global operator new (replaced in AllocationCounter.cpp) so we can check
+// that the simulation makes no heap allocations once it has warmed up.  The replacement is only
+// compiled with COUNT_HEAP_ALLOCATIONS defined (msbuild /p:CountHeapAllocations=true), so normal
+// builds of the game keep the standard allocator and --headless reports the count as unavailable.
+#if defined(COUNT_HEAP_ALLOCATIONS)
+size_t GetHeapAllocationCount();
+#endif
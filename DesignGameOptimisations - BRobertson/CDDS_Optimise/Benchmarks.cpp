@@ -0,0 +1,595 @@
+#include "Benchmarks.h"
+#include "ConcurrentObjectPool.h"
+#include "CritterStore.h"
+#include "FrameArena.h"
+#include "LinearQuadTree.h"
+#include "ObjectPool.h"
+#include "QuadTree.h"
+#include "Simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    // Stand-in for a spawned entity
+    struct PooledItem
+    {
+        float x = 0.0f, y = 0.0f, vx = 0.0f, vy = 0.0f;
+    };
+
+    const int POOL_BATCH = 16;   // Objects each thread holds at once between Get and Return
+
+    // Run 'threads' workers that each do 'ops' Get/Return pairs; returns million pairs per second
+    template <typename Worker>
+    double TimeThreads(int threads, int ops, Worker worker)
+    {
+        std::vector<std::thread> workers;
+        auto start = Clock::now();
+        for (int t = 0; t < threads; ++t)
+            workers.emplace_back(worker, ops);
+        for (std::thread& w : workers)
+            w.join();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return (static_cast<double>(threads) * ops) / seconds / 1.0e6;
+    }
+
+    int BenchmarkPool(int argc, char* argv[])
+    {
+        const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+        const int maxThreads = argc > 3 ? std::atoi(argv[3]) : (hardware > 0 ? hardware : 1);
+        const int ops = argc > 4 ? std::atoi(argv[4]) : 2000000;
+        const size_t capacity = static_cast<size_t>(maxThreads) * POOL_BATCH * 64;
+
+        std::cout << "Pool contention, " << ops << " Get/Return pairs per thread (Mops/s)" << std::endl;
+
+        // 1, 2, 4, ... up to maxThreads
+        std::vector<int> threadCounts;
+        for (int threads = 1; threads < maxThreads; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(maxThreads);
+
+        double lockFreeBase = 0.0;
+        for (int threads : threadCounts)
+        {
+            // Lock-free pool with one ThreadCache per worker
+            ConcurrentObjectPool<PooledItem> concurrentPool(capacity, static_cast<size_t>(threads));
+            double lockFree = TimeThreads(threads, ops, [&concurrentPool](int count)
+            {
+                ConcurrentObjectPool<PooledItem>::ThreadCache cache(concurrentPool);
+                PoolHandle held[POOL_BATCH];
+                for (int done = 0; done < count; done += POOL_BATCH)
+                {
+                    for (PoolHandle& handle : held)
+                    {
+                        handle = cache.Get();
+                        concurrentPool[handle].x += 1.0f;
+                    }
+                    for (PoolHandle handle : held)
+                        cache.Return(handle);
+                }
+            });
+
+            // Baseline: the single-threaded ObjectPool behind a mutex
+            ObjectPool<PooledItem> lockedPool(capacity);
+            std::mutex lock;
+            double locked = TimeThreads(threads, ops, [&lockedPool, &lock](int count)
+            {
+                PoolHandle held[POOL_BATCH];
+                for (int done = 0; done < count; done += POOL_BATCH)
+                {
+                    for (PoolHandle& handle : held)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        handle = lockedPool.Get();
+                        lockedPool[handle].x += 1.0f;
+                    }
+                    for (PoolHandle handle : held)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        lockedPool.Return(handle);
+                    }
+                }
+            });
+
+            if (threads == 1)
+                lockFreeBase = lockFree;
+
+            std::cout << "Threads: " << threads
+                      << ", Lock-free: " << lockFree
+                      << " (scaling " << lockFree / (lockFreeBase * threads) * 100.0 << "%)"
+                      << ", Mutex: " << locked << std::endl;
+        }
+        return 0;
+    }
+
+    // The quadtree as it was before the flat layout: heap-allocated nodes with four child pointers
+    // and a vector of points each.  Kept only as the baseline for the quadtree benchmark.
+    class PointerQuadTree
+    {
+    private:
+        static const int CAPACITY = 4;
+
+        AABB                     m_region;
+        std::vector<CritterView> m_points;
+        PointerQuadTree*         m_children[4] = { nullptr, nullptr, nullptr, nullptr };
+
+    public:
+        explicit PointerQuadTree(const AABB& region) : m_region(region) {}
+        ~PointerQuadTree() { Clear(); }
+
+        PointerQuadTree(const PointerQuadTree&) = delete;
+        PointerQuadTree& operator=(const PointerQuadTree&) = delete;
+
+        bool Insert(CritterView critter, const Vector2& position)
+        {
+            if (!m_region.Contains(position))
+                return false;
+
+            if (m_points.size() < CAPACITY)
+            {
+                m_points.push_back(critter);
+                return true;
+            }
+
+            if (!m_children[0])
+            {
+                const Rectangle& b = m_region.bounds;
+                const float w = b.width * 0.5f;
+                const float h = b.height * 0.5f;
+                m_children[0] = new PointerQuadTree(AABB{ { b.x,     b.y,     w, h } });
+                m_children[1] = new PointerQuadTree(AABB{ { b.x + w, b.y,     w, h } });
+                m_children[2] = new PointerQuadTree(AABB{ { b.x,     b.y + h, w, h } });
+                m_children[3] = new PointerQuadTree(AABB{ { b.x + w, b.y + h, w, h } });
+            }
+
+            for (PointerQuadTree* child : m_children)
+            {
+                if (child->Insert(critter, position))
+                    return true;
+            }
+            return false;
+        }
+
+        void Query(const AABB& range, ArenaVector<CritterView>& outResults) const
+        {
+            if (!m_region.Intersects(range))
+                return;
+
+            for (const CritterView& critter : m_points)
+            {
+                if (range.Contains(critter->GetPosition()))
+                    outResults.push_back(critter);
+            }
+
+            if (m_children[0])
+            {
+                for (const PointerQuadTree* child : m_children)
+                    child->Query(range, outResults);
+            }
+        }
+
+        void Clear()
+        {
+            m_points.clear();
+            for (PointerQuadTree*& child : m_children)
+            {
+                delete child;
+                child = nullptr;
+            }
+        }
+    };
+
+    // Fill a store with critters spread uniformly over the world
+    void ScatterCritters(CritterStore& store, int count, float width, float height, float radius, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> xs(0.0f, width);
+        std::uniform_real_distribution<float> ys(0.0f, height);
+        store.Reserve(static_cast<size_t>(count));
+        for (int i = 0; i < count; ++i)
+            store.Add(Vector2{ xs(rng), ys(rng) }, Vector2{ 0.0f, 0.0f }, radius);
+    }
+
+    // Nudge every critter a little, clamped to the world, so each frame's tree differs
+    void JitterCritters(CritterStore& store, float width, float height, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> step(-2.0f, 2.0f);
+        float* x = store.X();
+        float* y = store.Y();
+        for (size_t i = 0; i < store.Size(); ++i)
+        {
+            x[i] = std::min(std::max(x[i] + step(rng), 0.0f), width);
+            y[i] = std::min(std::max(y[i] + step(rng), 0.0f), height);
+        }
+    }
+
+    // Rebuild the tree and run one neighbour query per critter, 'frames' times.  Returns the
+    // milliseconds per frame; 'found' accumulates the query hits so both trees can be compared.
+    template <typename Tree>
+    double TimeQuadTree(Tree& tree, CritterStore& store, int frames, float width, float height, unsigned seed, size_t& found)
+    {
+        std::mt19937 rng(seed);
+        FrameArena arena;
+        const float range = store.GetRadius(0) * 2.0f;
+        const uint32_t count = static_cast<uint32_t>(store.Size());
+
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            JitterCritters(store, width, height, rng);
+            arena.Reset();
+
+            tree.Clear();
+            for (uint32_t i = 0; i < count; ++i)
+                tree.Insert(store.Get(i), store.GetPosition(i));
+
+            ArenaVector<CritterView> results{ ArenaAllocator<CritterView>(&arena) };
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const Vector2 p = store.GetPosition(i);
+                results.clear();
+                tree.Query(AABB{ { p.x - range * 0.5f, p.y - range * 0.5f, range, range } }, results);
+                found += results.size();
+            }
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+    }
+
+    int BenchmarkQuadTree(int argc, char* argv[])
+    {
+        const int critters = argc > 3 ? std::atoi(argv[3]) : 5000;
+        const int frames = argc > 4 ? std::atoi(argv[4]) : 200;
+        const float width = 800.0f, height = 450.0f, radius = 12.0f;
+        const unsigned seed = 1234;
+        const AABB world{ { 0.0f, 0.0f, width, height } };
+
+        // Identical starting positions and jitter for both trees
+        std::mt19937 rng(seed);
+        CritterStore flatStore, pointerStore;
+        ScatterCritters(flatStore, critters, width, height, radius, rng);
+        rng.seed(seed);
+        ScatterCritters(pointerStore, critters, width, height, radius, rng);
+
+        QuadTree flat(world);
+        PointerQuadTree pointer(world);
+        size_t flatFound = 0, pointerFound = 0;
+        const double flatMs = TimeQuadTree(flat, flatStore, frames, width, height, seed, flatFound);
+        const double pointerMs = TimeQuadTree(pointer, pointerStore, frames, width, height, seed, pointerFound);
+
+        std::cout << "QuadTree rebuild + query, " << critters << " critters, " << frames << " frames (ms/frame)" << std::endl;
+        std::cout << "Flat: " << flatMs << ", Pointer: " << pointerMs
+                  << ", Speedup: " << pointerMs / flatMs << "x" << std::endl;
+        if (flatFound != pointerFound)
+        {
+            std::cerr << "Mismatch: flat found " << flatFound << ", pointer found " << pointerFound << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Full rebuild of the Morton-sorted linear quadtree and the bulk QuadTree build with 1, 2, 4, ... threads, against
+    // an incremental QuadTree build from empty
+    int BenchmarkLinear(int argc, char* argv[])
+    {
+        const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+        const int critters = argc > 3 ? std::atoi(argv[3]) : 1000000;
+        const int maxThreads = argc > 4 ? std::atoi(argv[4]) : (hardware > 0 ? hardware : 1);
+        const int builds = 10;
+        const float width = 800.0f, height = 450.0f;
+        const AABB world{ { 0.0f, 0.0f, width, height } };
+
+        std::mt19937 rng(1234);
+        CritterStore store;
+        ScatterCritters(store, critters, width, height, 12.0f, rng);
+
+        std::cout << "Full rebuild, " << critters << " critters (ms/build)" << std::endl;
+
+        QuadTree tree(world);
+        auto start = Clock::now();
+        for (int i = 0; i < builds; ++i)
+        {
+            tree.Clear();
+            tree.Build(store);
+        }
+        const double treeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / builds;
+        std::cout << "QuadTree: " << treeMs << std::endl;
+
+        start = Clock::now();
+        for (int i = 0; i < builds; ++i)
+            tree.BulkLoad(store);
+        const double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / builds;
+        std::cout << "QuadTree BulkLoad: " << loadMs << " (speedup " << treeMs / loadMs << "x)" << std::endl;
+
+        std::vector<int> threadCounts;
+        for (int threads = 1; threads < maxThreads; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(maxThreads);
+
+        LinearQuadTree linear(world);
+        double base = 0.0;
+        for (int threads : threadCounts)
+        {
+            linear.SetThreadCount(static_cast<unsigned>(threads));
+            linear.Build(store);   // Warm up the arrays
+            start = Clock::now();
+            for (int i = 0; i < builds; ++i)
+                linear.Build(store);
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / builds;
+            if (threads == 1)
+                base = ms;
+            std::cout << "Linear, threads " << threads << ": " << ms << " (speedup " << base / ms << "x)" << std::endl;
+        }
+
+        // Bulk QuadTree build from the same items each time (it reorders them); every thread count must produce the
+        // same tree, checked through the order a full-region query visits critters in
+        std::vector<QuadTree::BulkItem> source(store.Size());
+        for (uint32_t i = 0; i < store.Size(); ++i)
+            source[i] = QuadTree::BulkItem{ store.Get(i), store.GetPosition(i), store.GetRadius(i) };
+        std::vector<QuadTree::BulkItem> items;
+
+        uint64_t expected = 0;
+        for (int threads : threadCounts)
+        {
+            tree.SetThreadCount(static_cast<unsigned>(threads));
+            double ms = 0.0;
+            for (int i = 0; i < builds; ++i)
+            {
+                items = source;
+                start = Clock::now();
+                tree.Build(items.data(), items.size());
+                ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            }
+            ms /= builds;
+            if (threads == 1)
+                base = ms;
+            std::cout << "QuadTree bulk, threads " << threads << ": " << ms << " (speedup " << base / ms << "x)" << std::endl;
+
+            uint64_t order = 14695981039346656037ull;
+            tree.Query(tree.GetRegion(), [&order](CritterView critter) {
+                order = (order ^ critter.GetIndex()) * 1099511628211ull;
+                return true;
+            });
+            if (threads == 1)
+                expected = order;
+            else if (order != expected)
+            {
+                std::cerr << "Mismatch: bulk build with " << threads << " threads differs from the serial build" << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // Build + QueryPairs on every backend with radii spread log-uniformly from 2 to 100, the mix the
+    // dynamic AABB tree is for.  Pair counts must agree between backends.
+    int BenchmarkWideRadii(int argc, char* argv[])
+    {
+        const int critters = argc > 3 ? std::atoi(argv[3]) : 5000;
+        const int frames = argc > 4 ? std::atoi(argv[4]) : 100;
+        const float width = 4000.0f, height = 2250.0f;
+        const AABB world{ { 0.0f, 0.0f, width, height } };
+        const unsigned seed = 1234;
+
+        std::cout << "Build + QueryPairs, " << critters << " critters with radius 2-100, " << frames
+                  << " frames (ms/frame)" << std::endl;
+
+        size_t expectedPairs = 0;
+        for (int i = 0; i < static_cast<int>(SpatialIndexType::Count); ++i)
+        {
+            const SpatialIndexType type = static_cast<SpatialIndexType>(i);
+
+            // Same critters and moves for every backend
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> xs(0.0f, width);
+            std::uniform_real_distribution<float> ys(0.0f, height);
+            std::uniform_real_distribution<float> logRadius(std::log(2.0f), std::log(100.0f));
+            CritterStore store;
+            store.Reserve(static_cast<size_t>(critters));
+            for (int c = 0; c < critters; ++c)
+                store.Add(Vector2{ xs(rng), ys(rng) }, Vector2{ 0.0f, 0.0f }, std::exp(logRadius(rng)));
+
+            std::unique_ptr<ISpatialIndex> index = CreateSpatialIndex(type, world, 24.0f);
+            size_t pairs = 0;
+            auto countPair = [&pairs](CritterView, CritterView) { ++pairs; };
+
+            auto start = Clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                JitterCritters(store, width, height, rng);
+                index->Build(store);
+                index->QueryPairs(countPair);
+            }
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+
+            std::cout << GetSpatialIndexName(type) << ": " << ms << " (" << pairs / frames << " pairs/frame)" << std::endl;
+            if (i == 0)
+                expectedPairs = pairs;
+            else if (pairs != expectedPairs)
+            {
+                std::cerr << "Mismatch: " << GetSpatialIndexName(type) << " found " << pairs << " pairs, expected "
+                          << expectedPairs << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // Run the full simulation once per broadphase backend with identical seeds.  A long thin world
+    // (e.g. 8000 x 100) gives the crowded, nearly 1D distribution sweep-and-prune is meant for.
+    int BenchmarkIndex(int argc, char* argv[])
+    {
+        const int critters = argc > 3 ? std::atoi(argv[3]) : 5000;
+        const int frames = argc > 4 ? std::atoi(argv[4]) : 300;
+        const float width = argc > 5 ? static_cast<float>(std::atof(argv[5])) : 800.0f;
+        const float height = argc > 6 ? static_cast<float>(std::atof(argv[6])) : 450.0f;
+        const float dt = 1.0f / 60.0f;
+
+        std::cout << "Simulation step per spatial index, " << critters << " critters, " << frames << " frames, "
+                  << width << "x" << height << " world (ms/step: pairs / per-critter)" << std::endl;
+        const CollisionMode modes[] = { CollisionMode::Pairs, CollisionMode::PerCritter };
+        for (int i = 0; i < static_cast<int>(SpatialIndexType::Count); ++i)
+        {
+            std::cout << GetSpatialIndexName(static_cast<SpatialIndexType>(i)) << ":";
+            for (CollisionMode mode : modes)
+            {
+                SimulationConfig config;
+                config.seed = 1234u;
+                config.critterCount = critters;
+                config.worldWidth = width;
+                config.worldHeight = height;
+                config.spatialIndex = static_cast<SpatialIndexType>(i);
+                config.collisionMode = mode;
+
+                Simulation simulation(config);
+                auto start = Clock::now();
+                for (int frame = 0; frame < frames; ++frame)
+                    simulation.Step(dt);
+                const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+
+                std::cout << (mode == CollisionMode::Pairs ? " " : " / ") << ms;
+            }
+            std::cout << std::endl;
+        }
+        return 0;
+    }
+
+    // k-nearest and radius queries on the QuadTree against a brute-force scan of the store, from random points.
+    // The k-th distances must agree.
+    int BenchmarkNearest(int argc, char* argv[])
+    {
+        const int critters = argc > 3 ? std::atoi(argv[3]) : 100000;
+        const int queries = argc > 4 ? std::atoi(argv[4]) : 1000;
+        const uint32_t k = 8;
+        const float width = 4000.0f, height = 2250.0f, radius = 50.0f;
+        const AABB world{ { 0.0f, 0.0f, width, height } };
+
+        std::mt19937 rng(1234);
+        CritterStore store;
+        ScatterCritters(store, critters, width, height, 2.0f, rng);
+        QuadTree tree(world);
+        tree.Build(store);
+
+        std::uniform_real_distribution<float> xs(0.0f, width);
+        std::uniform_real_distribution<float> ys(0.0f, height);
+        std::vector<Vector2> points(static_cast<size_t>(queries));
+        for (Vector2& point : points)
+            point = Vector2{ xs(rng), ys(rng) };
+
+        // Tree
+        std::vector<float> treeKth, bruteKth;
+        size_t treeInRadius = 0, bruteInRadius = 0;
+        QuadTree::Neighbour nearest[k];
+        auto start = Clock::now();
+        for (const Vector2& point : points)
+        {
+            const uint32_t found = tree.QueryKNearest(point, k, nearest);
+            treeKth.push_back(found > 0 ? nearest[found - 1].distanceSq : 0.0f);
+            tree.QueryRadius(point, radius, [&treeInRadius](CritterView, float) { ++treeInRadius; return true; });
+        }
+        const double treeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        // Brute force: partial sort of every squared distance
+        std::vector<float> distances(store.Size());
+        start = Clock::now();
+        for (const Vector2& point : points)
+        {
+            for (uint32_t i = 0; i < store.Size(); ++i)
+            {
+                const float dx = store.GetX(i) - point.x;
+                const float dy = store.GetY(i) - point.y;
+                distances[i] = dx * dx + dy * dy;
+                if (distances[i] <= radius * radius)
+                    ++bruteInRadius;
+            }
+            const size_t count = std::min<size_t>(k, distances.size());
+            std::nth_element(distances.begin(), distances.begin() + (count > 0 ? count - 1 : 0), distances.end());
+            bruteKth.push_back(count > 0 ? distances[count - 1] : 0.0f);
+        }
+        const double bruteMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::cout << "QueryKNearest (k = " << k << ") + QueryRadius (r = " << radius << "), " << critters << " critters, "
+                  << queries << " queries (ms total)" << std::endl;
+        std::cout << "QuadTree: " << treeMs << ", Brute force: " << bruteMs << ", Speedup: " << bruteMs / treeMs << "x" << std::endl;
+        if (treeKth != bruteKth || treeInRadius != bruteInRadius)
+        {
+            std::cerr << "Mismatch between QuadTree and brute force results" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Range and circle query throughput on a bulk-loaded QuadTree (the traversal the SIMD child tests speed up)
+    int BenchmarkQuery(int argc, char* argv[])
+    {
+        const int critters = argc > 3 ? std::atoi(argv[3]) : 1000000;
+        const int queries = argc > 4 ? std::atoi(argv[4]) : 100000;
+        const float width = 8000.0f, height = 4500.0f, range = 100.0f;
+        const AABB world{ { 0.0f, 0.0f, width, height } };
+
+        std::mt19937 rng(1234);
+        CritterStore store;
+        ScatterCritters(store, critters, width, height, 4.0f, rng);
+        QuadTree tree(world);
+        tree.BulkLoad(store);
+
+        std::uniform_real_distribution<float> xs(0.0f, width);
+        std::uniform_real_distribution<float> ys(0.0f, height);
+        std::vector<Vector2> points(static_cast<size_t>(queries));
+        for (Vector2& point : points)
+            point = Vector2{ xs(rng), ys(rng) };
+
+        size_t boxHits = 0;
+        auto start = Clock::now();
+        for (const Vector2& point : points)
+        {
+            const AABB box{ { point.x - range * 0.5f, point.y - range * 0.5f, range, range } };
+            tree.Query(box, [&boxHits](CritterView) { ++boxHits; return true; });
+        }
+        const double boxMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        size_t circleHits = 0;
+        start = Clock::now();
+        for (const Vector2& point : points)
+            tree.QueryCircle(point, range * 0.5f, [&circleHits](CritterView) { ++circleHits; return true; });
+        const double circleMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::cout << "QuadTree queries, " << critters << " critters, " << queries << " queries of size " << range
+                  << " (ms total)" << std::endl;
+        std::cout << "Query: " << boxMs << " (" << boxHits << " hits), QueryCircle: " << circleMs << " (" << circleHits
+                  << " hits)" << std::endl;
+        return 0;
+    }
+}
+
+int RunBenchmark(int argc, char* argv[])
+{
+    const char* name = argc > 2 ? argv[2] : "";
+
+    if (std::strcmp(name, "pool") == 0)
+        return BenchmarkPool(argc, argv);
+    if (std::strcmp(name, "quadtree") == 0)
+        return BenchmarkQuadTree(argc, argv);
+    if (std::strcmp(name, "index") == 0)
+        return BenchmarkIndex(argc, argv);
+    if (std::strcmp(name, "linear") == 0)
+        return BenchmarkLinear(argc, argv);
+    if (std::strcmp(name, "wide") == 0)
+        return BenchmarkWideRadii(argc, argv);
+    if (std::strcmp(name, "nearest") == 0)
+        return BenchmarkNearest(argc, argv);
+    if (std::strcmp(name, "query") == 0)
+        return BenchmarkQuery(argc, argv);
+
+    std::cerr << "Unknown benchmark '" << name << "'. Available: pool, quadtree, index, linear, wide, nearest, query" << std::endl;
+    return 1;
+}
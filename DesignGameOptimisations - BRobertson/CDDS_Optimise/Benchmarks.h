@@ -0,0 +1,12 @@
+#pragma once
+
+// Stand-alone micro benchmarks, run without a window.
+// Usage: CDDS_Optimise --bench <name> [args...]
+//   pool [maxThreads] [opsPerThread]   Get/Return contention on ConcurrentObjectPool vs a locked ObjectPool
+//   quadtree [critters] [frames]       Rebuild + neighbour queries on the flat QuadTree vs the old pointer tree
+//   index [critters] [frames] [w] [h]  Full simulation step with each ISpatialIndex backend, pairs and per-critter
+//   linear [critters] [maxThreads]     LinearQuadTree and bulk QuadTree rebuilds per thread count vs QuadTree
+//   wide [critters] [frames]           Build + QueryPairs per backend with radii from 2 to 100 (for the AABB tree)
+//   nearest [critters] [queries]       QuadTree QueryKNearest + QueryRadius vs a brute-force scan
+//   query [critters] [queries]         QuadTree Query / QueryCircle throughput on a bulk-loaded tree
+int RunBenchmark(int argc, char* argv[]);
@@ -0,0 +1,290 @@
+#pragma once
+#include "ObjectPool.h"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+// Thread-safe fixed-capacity pool for spawning/despawning from many worker threads.
+//
+// Free objects are kept in magazines (small fixed-size stacks of indices).  Each worker owns a
+// ThreadCache holding two magazines and serves Get/Return from them without touching shared state.
+// Only when both are empty (or both full) does it swap a whole magazine with the global depot,
+// which is a set of lock-free Treiber stacks.  No mutex is ever taken.
+//
+// Handles use the same 32-bit index+generation PoolHandle as ObjectPool; Return() advances the
+// generation with a compare-exchange, so a double Return from any thread is rejected and reported.
+
+template <typename T, size_t MAGAZINE_SIZE = 64>
+class ConcurrentObjectPool
+{
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+    // Lock-free stack of indices linked through an external array of next links.
+    // The head packs a 32-bit ABA tag above the top index.
+    class LinkedStack
+    {
+    private:
+        std::atomic<uint64_t> m_head{ NONE };
+
+    public:
+        void Push(std::atomic<uint32_t>* links, uint32_t index)
+        {
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            uint64_t desired;
+            do
+            {
+                links[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+                desired = (((head >> 32) + 1) << 32) | index;
+            } while (!m_head.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        uint32_t Pop(std::atomic<uint32_t>* links)
+        {
+            uint64_t head = m_head.load(std::memory_order_acquire);
+            uint64_t desired;
+            do
+            {
+                const uint32_t top = static_cast<uint32_t>(head);
+                if (top == NONE)
+                    return NONE;
+                const uint32_t next = links[top].load(std::memory_order_relaxed);
+                desired = (((head >> 32) + 1) << 32) | next;
+            } while (!m_head.compare_exchange_weak(head, desired, std::memory_order_acquire, std::memory_order_acquire));
+            return static_cast<uint32_t>(head);
+        }
+    };
+
+    struct Magazine
+    {
+        uint32_t items[MAGAZINE_SIZE];
+        uint32_t count = 0;
+    };
+
+    size_t                                   m_capacity;
+    std::unique_ptr<T[]>                     m_objects;        // Contiguous storage for every object
+    std::unique_ptr<std::atomic<uint32_t>[]> m_generations;    // Current generation of each object
+    std::unique_ptr<std::atomic<uint32_t>[]> m_objectLinks;    // Next links for m_loose
+
+    size_t                                   m_magazineCount;
+    std::unique_ptr<Magazine[]>              m_magazines;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_magazineLinks;  // Next links for m_full/m_empty
+
+    LinkedStack                              m_full;           // Magazines holding exactly MAGAZINE_SIZE free objects
+    LinkedStack                              m_empty;          // Magazines holding none
+    LinkedStack                              m_loose;          // Free objects not in any magazine (leftovers of partial magazines)
+    std::atomic<size_t>                      m_rejectedReturns{ 0 };
+
+public:
+    // Per-thread front end.  Create one per worker thread and only use it from that thread;
+    // its destructor hands any cached objects back to the depot.  Constructing more than
+    // maxThreadCaches at once throws std::runtime_error, since the cache could not get its magazines.
+    class ThreadCache
+    {
+    private:
+        ConcurrentObjectPool& m_pool;
+        uint32_t              m_loaded;     // Magazine Get/Return work on
+        uint32_t              m_previous;   // Spare, swapped in before going to the depot
+
+        Magazine& Loaded() { return m_pool.m_magazines[m_loaded]; }
+        Magazine& Previous() { return m_pool.m_magazines[m_previous]; }
+
+    public:
+        explicit ThreadCache(ConcurrentObjectPool& pool);
+        ~ThreadCache();
+
+        ThreadCache(const ThreadCache&) = delete;
+        ThreadCache& operator=(const ThreadCache&) = delete;
+
+        // Acquire an object, or an invalid handle if the pool is exhausted
+        PoolHandle Get();
+
+        // Return an object; rejected and reported if the handle is stale
+        bool Return(PoolHandle handle);
+    };
+
+    // 'capacity' objects are created up front.  maxThreadCaches bounds how many ThreadCaches may
+    // exist at once, which sizes the spare magazines so Return never runs out of room.
+    ConcurrentObjectPool(size_t capacity, size_t maxThreadCaches = 64);
+
+    ConcurrentObjectPool(const ConcurrentObjectPool&) = delete;
+    ConcurrentObjectPool& operator=(const ConcurrentObjectPool&) = delete;
+
+    // Object for a handle, or nullptr if the handle is stale
+    T* Resolve(PoolHandle handle) const
+    {
+        return IsValid(handle) ? &m_objects[handle.Index()] : nullptr;
+    }
+
+    // Unchecked access for handles known to be live
+    T& operator[](PoolHandle handle) const { return m_objects[handle.Index()]; }
+
+    bool IsValid(PoolHandle handle) const
+    {
+        return handle.Index() < m_capacity
+            && m_generations[handle.Index()].load(std::memory_order_acquire) == handle.Generation();
+    }
+
+    size_t GetCapacity() const { return m_capacity; }
+    size_t GetRejectedReturns() const { return m_rejectedReturns.load(std::memory_order_relaxed); }
+};
+
+template <typename T, size_t MAGAZINE_SIZE>
+ConcurrentObjectPool<T, MAGAZINE_SIZE>::ConcurrentObjectPool(size_t capacity, size_t maxThreadCaches)
+    : m_capacity(capacity < PoolHandle::INDEX_MASK ? capacity : PoolHandle::INDEX_MASK)
+    , m_objects(new T[m_capacity])
+    , m_generations(new std::atomic<uint32_t>[m_capacity])
+    , m_objectLinks(new std::atomic<uint32_t>[m_capacity])
+{
+    // The depot only ever holds full magazines, so this is enough for every free object to sit
+    // in one, plus two per cache and a spare: Return can always find an empty magazine.
+    const size_t fullMagazines = m_capacity / MAGAZINE_SIZE;
+    m_magazineCount = fullMagazines + 2 * maxThreadCaches + 1;
+    m_magazines.reset(new Magazine[m_magazineCount]);
+    m_magazineLinks.reset(new std::atomic<uint32_t>[m_magazineCount]);
+
+    for (size_t i = 0; i < m_capacity; ++i)
+        m_generations[i].store(1, std::memory_order_relaxed);
+
+    // Fill magazines with every index, pushed in reverse so the lowest indices are handed out first
+    for (size_t i = m_capacity; i-- > fullMagazines * MAGAZINE_SIZE;)
+        m_loose.Push(m_objectLinks.get(), static_cast<uint32_t>(i));
+    for (size_t m = fullMagazines; m-- > 0;)
+    {
+        Magazine& magazine = m_magazines[m];
+        for (size_t i = (m + 1) * MAGAZINE_SIZE; i-- > m * MAGAZINE_SIZE;)
+            magazine.items[magazine.count++] = static_cast<uint32_t>(i);
+        m_full.Push(m_magazineLinks.get(), static_cast<uint32_t>(m));
+    }
+    for (size_t m = fullMagazines; m < m_magazineCount; ++m)
+        m_empty.Push(m_magazineLinks.get(), static_cast<uint32_t>(m));
+}
+
+template <typename T, size_t MAGAZINE_SIZE>
+ConcurrentObjectPool<T, MAGAZINE_SIZE>::ThreadCache::ThreadCache(ConcurrentObjectPool& pool)
+    : m_pool(pool)
+    , m_loaded(pool.m_empty.Pop(pool.m_magazineLinks.get()))
+    , m_previous(pool.m_empty.Pop(pool.m_magazineLinks.get()))
+{
+    if (m_loaded == NONE || m_previous == NONE)
+    {
+        // Give back whichever one we did get; the destructor won't run for a throwing constructor
+        if (m_loaded != NONE)
+            m_pool.m_empty.Push(m_pool.m_magazineLinks.get(), m_loaded);
+        if (m_previous != NONE)
+            m_pool.m_empty.Push(m_pool.m_magazineLinks.get(), m_previous);
+
+        assert(!"ConcurrentObjectPool: more ThreadCaches than maxThreadCaches");
+        throw std::runtime_error("ConcurrentObjectPool: more ThreadCaches than maxThreadCaches");
+    }
+}
+
+// Full magazines go back to the depot as they are; objects in partial ones are pushed individually
+// onto the loose list so the depot only ever holds full magazines.
+
+template <typename T, size_t MAGAZINE_SIZE>
+ConcurrentObjectPool<T, MAGAZINE_SIZE>::ThreadCache::~ThreadCache()
+{
+    for (uint32_t index : { m_loaded, m_previous })
+    {
+        if (index == NONE)
+            continue;
+
+        Magazine& magazine = m_pool.m_magazines[index];
+        if (magazine.count == MAGAZINE_SIZE)
+        {
+            m_pool.m_full.Push(m_pool.m_magazineLinks.get(), index);
+            continue;
+        }
+
+        while (magazine.count > 0)
+            m_pool.m_loose.Push(m_pool.m_objectLinks.get(), magazine.items[--magazine.count]);
+        m_pool.m_empty.Push(m_pool.m_magazineLinks.get(), index);
+    }
+}
+
+template <typename T, size_t MAGAZINE_SIZE>
+PoolHandle ConcurrentObjectPool<T, MAGAZINE_SIZE>::ThreadCache::Get()
+{
+    if (Loaded().count == 0)
+    {
+        if (Previous().count > 0)
+        {
+            std::swap(m_loaded, m_previous);
+        }
+        else
+        {
+            // Trade our empty magazine for a full one from the depot
+            const uint32_t full = m_pool.m_full.Pop(m_pool.m_magazineLinks.get());
+            if (full != NONE)
+            {
+                m_pool.m_empty.Push(m_pool.m_magazineLinks.get(), m_loaded);
+                m_loaded = full;
+            }
+            else
+            {
+                // Depot is dry: fall back to single leftover objects
+                const uint32_t index = m_pool.m_loose.Pop(m_pool.m_objectLinks.get());
+                if (index == NONE)
+                    return PoolHandle();   // Exhausted
+                return PoolHandle(index, m_pool.m_generations[index].load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    Magazine& magazine = Loaded();
+    const uint32_t index = magazine.items[--magazine.count];
+    return PoolHandle(index, m_pool.m_generations[index].load(std::memory_order_relaxed));
+}
+
+template <typename T, size_t MAGAZINE_SIZE>
+bool ConcurrentObjectPool<T, MAGAZINE_SIZE>::ThreadCache::Return(PoolHandle handle)
+{
+    const uint32_t index = handle.Index();
+
+    // Advance the generation (skipping 0 on wrap); only one Return of a handle can win this
+    uint32_t expected = handle.Generation();
+    uint32_t desired = (expected + 1) & PoolHandle::GENERATION_MASK;
+    if (desired == 0)
+        desired = 1;
+    if (index >= m_pool.m_capacity
+        || !m_pool.m_generations[index].compare_exchange_strong(expected, desired, std::memory_order_acq_rel))
+    {
+        m_pool.m_rejectedReturns.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "ConcurrentObjectPool: rejected Return of stale handle (index " << index
+                  << ", generation " << handle.Generation() << ")" << std::endl;
+        return false;
+    }
+
+    if (Loaded().count == MAGAZINE_SIZE)
+    {
+        if (Previous().count < MAGAZINE_SIZE)
+        {
+            std::swap(m_loaded, m_previous);
+        }
+        else
+        {
+            // Hand a full magazine to the depot and continue with an empty one.  The pool is sized so
+            // there always is one; if not, the object goes on the loose list rather than being lost.
+            const uint32_t empty = m_pool.m_empty.Pop(m_pool.m_magazineLinks.get());
+            if (empty == NONE)
+            {
+                m_pool.m_loose.Push(m_pool.m_objectLinks.get(), index);
+                return true;
+            }
+
+            m_pool.m_full.Push(m_pool.m_magazineLinks.get(), m_previous);
+            m_previous = m_loaded;
+            m_loaded = empty;
+        }
+    }
+
+    Magazine& magazine = Loaded();
+    magazine.items[magazine.count++] = index;
+    return true;
+}
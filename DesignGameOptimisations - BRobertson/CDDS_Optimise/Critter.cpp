@@ -56,19 +56,6 @@ void Critter::Update(float dt)
     m_isDirty = false;
 }
 
-// Draw the critter if it's active.  Cast positions to int for pixel-perfect placement.
-
-void Critter::Draw()
-{
-    if (!m_isLoaded)
-        return;  // Skip inactive critters
-
-    // DrawTexture expects an int position
-    DrawTexture(*m_texture,
-        static_cast<int>(m_position.x),
-        static_cast<int>(m_position.y),
-        WHITE);  // WHITE is a Raylib colour constant
-}
 // Reset the critter for respawning: new position, velocity, radius, texture.  Marks it as active and clears the dirty flag.
  
 void Critter::Reset(Vector2 position, Vector2 velocity, float radius, Texture2D* texture)
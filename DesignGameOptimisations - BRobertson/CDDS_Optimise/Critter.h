@@ -27,9 +27,6 @@ public:
     // Update position & internal state; dt = delta time since last frame
     void Update(float dt);
 
-    // Draw the critter to the screen if loaded
-    void Draw();
-
     // Getters and setters for position, velocity, radius
     float   GetX() const { return m_position.x; }
     float   GetY() const { return m_position.y; }
@@ -44,6 +41,9 @@ public:
 
     float   GetRadius() const { return m_radius; }
 
+    // Texture the windowed build draws this critter with (null when running headless)
+    Texture2D* GetTexture() const { return m_texture; }
+
     // Dirty flag indicates we've already handled a collision this frame
     bool    IsDirty() const { return m_isDirty; }
     void    SetDirty() { m_isDirty = true; }
@@ -0,0 +1,205 @@
+#include "CritterKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRITTER_KERNELS_SSE2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CRITTER_KERNELS_TARGET_AVX2
+#else
+#define CRITTER_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    // Pointers into the store shared by every path
+    struct Arrays
+    {
+        float*          x;
+        float*          y;
+        float*          vx;
+        float*          vy;
+        const float*    radius;
+        const uint64_t* alive;
+    };
+
+    Arrays GetArrays(CritterStore& critters)
+    {
+        return { critters.X(), critters.Y(), critters.VX(), critters.VY(), critters.Radius(), critters.AliveBits() };
+    }
+
+    // Scalar update of one axis: same steps and order as the SIMD lanes below
+    inline void BounceAxis(float& pos, float& vel, float r, float limit)
+    {
+        if (pos - r < 0.0f)
+        {
+            pos = r;
+            vel *= -1.0f;
+        }
+        else if (pos + r > limit)
+        {
+            pos = limit - r;
+            vel *= -1.0f;
+        }
+    }
+
+    void ScalarRange(const Arrays& a, size_t begin, size_t end, float dt, float width, float height)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if ((a.alive[i >> 6] & (uint64_t(1) << (i & 63))) == 0)
+                continue;
+
+            float x = a.x[i] + a.vx[i] * dt;
+            float y = a.y[i] + a.vy[i] * dt;
+            BounceAxis(x, a.vx[i], a.radius[i], width);
+            BounceAxis(y, a.vy[i], a.radius[i], height);
+            a.x[i] = x;
+            a.y[i] = y;
+        }
+    }
+
+#if CRITTER_KERNELS_SSE2
+
+    // Expand 4 alive bits starting at 'first' into an all-ones/all-zeros lane mask
+    inline __m128 AliveMask4(const uint64_t* alive, size_t first)
+    {
+        const int bits = static_cast<int>((alive[first >> 6] >> (first & 63)) & 0xF);
+        const __m128i lane = _mm_setr_epi32(1, 2, 4, 8);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lane), lane));
+    }
+
+    // mask ? a : b
+    inline __m128 Select4(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // Integrate and bounce one axis for 4 critters, writing only live lanes
+    inline void Axis4(float* pos, float* vel, __m128 r, __m128 limit, __m128 dt, __m128 alive)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 sign = _mm_set1_ps(-0.0f);
+
+        __m128 p = _mm_loadu_ps(pos);
+        __m128 v = _mm_loadu_ps(vel);
+
+        __m128 moved = _mm_add_ps(p, _mm_mul_ps(v, dt));
+        __m128 low = _mm_cmplt_ps(_mm_sub_ps(moved, r), zero);
+        __m128 high = _mm_andnot_ps(low, _mm_cmpgt_ps(_mm_add_ps(moved, r), limit));
+
+        __m128 clamped = Select4(low, r, Select4(high, _mm_sub_ps(limit, r), moved));
+        __m128 reflected = _mm_xor_ps(v, _mm_and_ps(_mm_or_ps(low, high), sign));
+
+        _mm_storeu_ps(pos, Select4(alive, clamped, p));
+        _mm_storeu_ps(vel, Select4(alive, reflected, v));
+    }
+
+    void IntegrateAndBounceSSE2(const Arrays& a, size_t count, float dt, float width, float height)
+    {
+        const __m128 dt4 = _mm_set1_ps(dt);
+        const __m128 width4 = _mm_set1_ps(width);
+        const __m128 height4 = _mm_set1_ps(height);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 alive = AliveMask4(a.alive, i);
+            const __m128 r = _mm_loadu_ps(a.radius + i);
+            Axis4(a.x + i, a.vx + i, r, width4, dt4, alive);
+            Axis4(a.y + i, a.vy + i, r, height4, dt4, alive);
+        }
+        ScalarRange(a, i, count, dt, width, height);
+    }
+
+    // 8-wide version of AliveMask4
+    CRITTER_KERNELS_TARGET_AVX2 inline __m256 AliveMask8(const uint64_t* alive, size_t first)
+    {
+        const int bits = static_cast<int>((alive[first >> 6] >> (first & 63)) & 0xFF);
+        const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lane), lane));
+    }
+
+    // 8-wide version of Axis4
+    CRITTER_KERNELS_TARGET_AVX2 inline void Axis8(float* pos, float* vel, __m256 r, __m256 limit, __m256 dt, __m256 alive)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+
+        __m256 p = _mm256_loadu_ps(pos);
+        __m256 v = _mm256_loadu_ps(vel);
+
+        __m256 moved = _mm256_add_ps(p, _mm256_mul_ps(v, dt));
+        __m256 low = _mm256_cmp_ps(_mm256_sub_ps(moved, r), zero, _CMP_LT_OQ);
+        __m256 high = _mm256_andnot_ps(low, _mm256_cmp_ps(_mm256_add_ps(moved, r), limit, _CMP_GT_OQ));
+
+        __m256 clamped = _mm256_blendv_ps(_mm256_blendv_ps(moved, _mm256_sub_ps(limit, r), high), r, low);
+        __m256 reflected = _mm256_xor_ps(v, _mm256_and_ps(_mm256_or_ps(low, high), sign));
+
+        _mm256_storeu_ps(pos, _mm256_blendv_ps(p, clamped, alive));
+        _mm256_storeu_ps(vel, _mm256_blendv_ps(v, reflected, alive));
+    }
+
+    CRITTER_KERNELS_TARGET_AVX2 void IntegrateAndBounceAVX2(const Arrays& a, size_t count, float dt, float width, float height)
+    {
+        const __m256 dt8 = _mm256_set1_ps(dt);
+        const __m256 width8 = _mm256_set1_ps(width);
+        const __m256 height8 = _mm256_set1_ps(height);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 alive = AliveMask8(a.alive, i);
+            const __m256 r = _mm256_loadu_ps(a.radius + i);
+            Axis8(a.x + i, a.vx + i, r, width8, dt8, alive);
+            Axis8(a.y + i, a.vy + i, r, height8, dt8, alive);
+        }
+        ScalarRange(a, i, count, dt, width, height);
+    }
+
+    // AVX2 needs both CPU support and the OS saving the YMM registers
+    bool CpuHasAVX2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+
+#endif
+}
+
+void IntegrateAndBounce(CritterStore& critters, float dt, float width, float height)
+{
+    const Arrays a = GetArrays(critters);
+    const size_t count = critters.Size();
+
+#if CRITTER_KERNELS_SSE2
+    static const bool hasAVX2 = CpuHasAVX2();
+    if (hasAVX2)
+        IntegrateAndBounceAVX2(a, count, dt, width, height);
+    else
+        IntegrateAndBounceSSE2(a, count, dt, width, height);
+#else
+    ScalarRange(a, 0, count, dt, width, height);
+#endif
+}
+
+void IntegrateAndBounceScalar(CritterStore& critters, float dt, float width, float height)
+{
+    ScalarRange(GetArrays(critters), 0, critters.Size(), dt, width, height);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "CritterStore.h"
+
+// Bulk update kernels that run over every critter in a CritterStore.
+// The SIMD paths are branch-free and give bit-identical results to the scalar path.
+
+// Move every live critter by velocity * dt, clamp it inside [0, width] x [0, height] accounting for
+// its radius and reflect its velocity on any axis that hit a wall.  Dead critters are left untouched.
+// Picks AVX2 (8 critters per step) when the CPU supports it, otherwise SSE2 (4 per step).
+void IntegrateAndBounce(CritterStore& critters, float dt, float width, float height);
+
+// Reference implementation, one critter at a time
+void IntegrateAndBounceScalar(CritterStore& critters, float dt, float width, float height);
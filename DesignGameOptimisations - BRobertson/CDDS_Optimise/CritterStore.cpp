@@ -0,0 +1,63 @@
+#include "CritterStore.h"
+#include <algorithm>
+
+void CritterStore::Reserve(size_t capacity)
+{
+    m_x.reserve(capacity);
+    m_y.reserve(capacity);
+    m_vx.reserve(capacity);
+    m_vy.reserve(capacity);
+    m_radius.reserve(capacity);
+
+    const size_t words = (capacity + 63) / 64;
+    m_alive.reserve(words);
+    m_dirty.reserve(words);
+}
+
+// Append a critter at the end of every array.  A new word of flags is added each time we cross a multiple of 64.
+
+uint32_t CritterStore::Add(Vector2 position, Vector2 velocity, float radius)
+{
+    const uint32_t index = static_cast<uint32_t>(m_x.size());
+
+    m_x.push_back(position.x);
+    m_y.push_back(position.y);
+    m_vx.push_back(velocity.x);
+    m_vy.push_back(velocity.y);
+    m_radius.push_back(radius);
+
+    if (WordOf(index) >= m_alive.size())
+    {
+        m_alive.push_back(0);
+        m_dirty.push_back(0);
+    }
+    m_alive[WordOf(index)] |= BitOf(index);
+
+    return index;
+}
+
+void CritterStore::Clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_vx.clear();
+    m_vy.clear();
+    m_radius.clear();
+    m_alive.clear();
+    m_dirty.clear();
+}
+
+void CritterStore::ClearAllDirty()
+{
+    std::fill(m_dirty.begin(), m_dirty.end(), 0);
+}
+
+void CritterStore::Reset(uint32_t index, Vector2 position, Vector2 velocity, float radius)
+{
+    SetPosition(index, position);
+    SetVelocity(index, velocity);
+    m_radius[index] = radius;
+
+    m_alive[WordOf(index)] |= BitOf(index);
+    m_dirty[WordOf(index)] &= ~BitOf(index);
+}
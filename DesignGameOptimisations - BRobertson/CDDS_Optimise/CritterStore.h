@@ -0,0 +1,145 @@
+#pragma once
+#include "raylib.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CritterStore;
+
+// Lightweight handle onto one critter in a CritterStore.  Exposes the same getters/setters as Critter
+// so call sites that used Critter* read the same (operator-> lets c->GetX() keep working).
+
+class CritterView
+{
+private:
+    CritterStore* m_store;
+    uint32_t      m_index;
+
+public:
+    CritterView() : m_store(nullptr), m_index(0) {}
+    CritterView(CritterStore* store, uint32_t index) : m_store(store), m_index(index) {}
+
+    CritterView*       operator->()       { return this; }
+    const CritterView* operator->() const { return this; }
+
+    bool operator==(const CritterView& other) const { return m_index == other.m_index && m_store == other.m_store; }
+    bool operator!=(const CritterView& other) const { return !(*this == other); }
+
+    uint32_t      GetIndex() const { return m_index; }
+    CritterStore* GetStore() const { return m_store; }
+
+    // Same interface as Critter
+    inline float   GetX() const;
+    inline float   GetY() const;
+    inline void    SetX(float x);
+    inline void    SetY(float y);
+
+    inline Vector2 GetPosition() const;
+    inline void    SetPosition(Vector2 position);
+
+    inline Vector2 GetVelocity() const;
+    inline void    SetVelocity(Vector2 velocity);
+
+    inline float   GetRadius() const;
+
+    inline bool    IsDirty() const;
+    inline void    SetDirty();
+
+    inline bool    IsDead() const;
+    inline void    Destroy();
+
+    inline void    Reset(Vector2 position, Vector2 velocity, float radius);
+};
+
+// Structure-of-arrays storage for every critter.  Each field lives in its own contiguous array so
+// the integration and collision loops stream through memory instead of chasing per-critter pointers.
+// Alive and dirty flags are packed one bit per critter.
+
+class CritterStore
+{
+private:
+    std::vector<float>    m_x;         // Position
+    std::vector<float>    m_y;
+    std::vector<float>    m_vx;        // Velocity
+    std::vector<float>    m_vy;
+    std::vector<float>    m_radius;    // Collision radius
+
+    std::vector<uint64_t> m_alive;     // Bit set = critter is active
+    std::vector<uint64_t> m_dirty;     // Bit set = collision already handled this frame
+
+    static size_t   WordOf(uint32_t index) { return index >> 6; }
+    static uint64_t BitOf(uint32_t index)  { return uint64_t(1) << (index & 63); }
+
+public:
+    CritterStore() = default;
+
+    // Reserve room for 'capacity' critters
+    void Reserve(size_t capacity);
+
+    // Append a live critter and return its index
+    uint32_t Add(Vector2 position, Vector2 velocity, float radius);
+
+    // Remove every critter
+    void Clear();
+
+    size_t      Size() const { return m_x.size(); }
+    CritterView Get(uint32_t index) { return CritterView(this, index); }
+
+    // Clear the dirty flag on every critter so collisions can be re-checked this frame
+    void ClearAllDirty();
+
+    // Per-critter field access
+    float   GetX(uint32_t index) const { return m_x[index]; }
+    float   GetY(uint32_t index) const { return m_y[index]; }
+    void    SetX(uint32_t index, float x) { m_x[index] = x; }
+    void    SetY(uint32_t index, float y) { m_y[index] = y; }
+
+    Vector2 GetPosition(uint32_t index) const { return { m_x[index], m_y[index] }; }
+    void    SetPosition(uint32_t index, Vector2 position) { m_x[index] = position.x; m_y[index] = position.y; }
+
+    Vector2 GetVelocity(uint32_t index) const { return { m_vx[index], m_vy[index] }; }
+    void    SetVelocity(uint32_t index, Vector2 velocity) { m_vx[index] = velocity.x; m_vy[index] = velocity.y; }
+
+    float   GetRadius(uint32_t index) const { return m_radius[index]; }
+
+    bool    IsAlive(uint32_t index) const { return (m_alive[WordOf(index)] & BitOf(index)) != 0; }
+    bool    IsDirty(uint32_t index) const { return (m_dirty[WordOf(index)] & BitOf(index)) != 0; }
+    void    SetDirty(uint32_t index) { m_dirty[WordOf(index)] |= BitOf(index); }
+
+    // Mark a critter inactive.  Safe to call on an already dead critter.
+    void    Kill(uint32_t index) { m_alive[WordOf(index)] &= ~BitOf(index); }
+
+    // Respawn a critter with new values, marked alive and clean
+    void    Reset(uint32_t index, Vector2 position, Vector2 velocity, float radius);
+
+    // Raw arrays for bulk kernels
+    float*       X()       { return m_x.data(); }
+    float*       Y()       { return m_y.data(); }
+    float*       VX()      { return m_vx.data(); }
+    float*       VY()      { return m_vy.data(); }
+    const float* Radius() const { return m_radius.data(); }
+
+    // Packed alive flags, bit (i & 63) of word (i >> 6) is critter i
+    const uint64_t* AliveBits() const { return m_alive.data(); }
+};
+
+inline float   CritterView::GetX() const { return m_store->GetX(m_index); }
+inline float   CritterView::GetY() const { return m_store->GetY(m_index); }
+inline void    CritterView::SetX(float x) { m_store->SetX(m_index, x); }
+inline void    CritterView::SetY(float y) { m_store->SetY(m_index, y); }
+
+inline Vector2 CritterView::GetPosition() const { return m_store->GetPosition(m_index); }
+inline void    CritterView::SetPosition(Vector2 position) { m_store->SetPosition(m_index, position); }
+
+inline Vector2 CritterView::GetVelocity() const { return m_store->GetVelocity(m_index); }
+inline void    CritterView::SetVelocity(Vector2 velocity) { m_store->SetVelocity(m_index, velocity); }
+
+inline float   CritterView::GetRadius() const { return m_store->GetRadius(m_index); }
+
+inline bool    CritterView::IsDirty() const { return m_store->IsDirty(m_index); }
+inline void    CritterView::SetDirty() { m_store->SetDirty(m_index); }
+
+inline bool    CritterView::IsDead() const { return !m_store->IsAlive(m_index); }
+inline void    CritterView::Destroy() { m_store->Kill(m_index); }
+
+inline void    CritterView::Reset(Vector2 position, Vector2 velocity, float radius) { m_store->Reset(m_index, position, velocity, radius); }
@@ -0,0 +1,496 @@
+#include "DynamicAABBTree.h"
+#include <algorithm>
+#include <cassert>
+
+const uint32_t DynamicAABBTree::NONE;  // Bound to a const reference by vector::resize
+
+namespace
+{
+    template <typename Box>
+    inline Box Union(const Box& a, const Box& b)
+    {
+        return Box{ std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY) };
+    }
+
+    // Cost metric for choosing where a leaf goes (the 2D stand-in for surface area)
+    template <typename Box>
+    inline float Perimeter(const Box& box)
+    {
+        return 2.0f * ((box.maxX - box.minX) + (box.maxY - box.minY));
+    }
+
+    template <typename Box>
+    inline bool Overlaps(const Box& a, const Box& b)
+    {
+        return a.minX <= b.maxX && a.maxX >= b.minX && a.minY <= b.maxY && a.maxY >= b.minY;
+    }
+
+    template <typename Box>
+    inline bool ContainsBox(const Box& outer, const Box& inner)
+    {
+        return outer.minX <= inner.minX && outer.minY <= inner.minY && outer.maxX >= inner.maxX && outer.maxY >= inner.maxY;
+    }
+}
+
+DynamicAABBTree::DynamicAABBTree(float fatMargin)
+    : m_root(NONE)
+    , m_freeList(NONE)
+    , m_store(nullptr)
+    , m_fatMargin(fatMargin)
+{
+}
+
+uint32_t DynamicAABBTree::AllocateNode()
+{
+    uint32_t node = m_freeList;
+    if (node != NONE)
+        m_freeList = m_nodes[node].parent;
+    else
+    {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(Node());
+    }
+
+    Node& n = m_nodes[node];
+    n.parent = NONE;
+    n.child1 = NONE;
+    n.child2 = NONE;
+    n.height = 0;
+    n.item = NONE;
+    return node;
+}
+
+void DynamicAABBTree::FreeNode(uint32_t node)
+{
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+// Walk down picking whichever child is cheaper to grow, stopping when making a new parent right here costs less than
+// descending.  The leaf and its chosen sibling then share a new parent, and everything above is refitted.
+
+void DynamicAABBTree::InsertLeaf(uint32_t leaf)
+{
+    if (m_root == NONE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NONE;
+        return;
+    }
+
+    const Box leafBox = m_nodes[leaf].box;
+    uint32_t index = m_root;
+    while (!IsLeaf(index))
+    {
+        const Node& node = m_nodes[index];
+        const float area = Perimeter(node.box);
+        const float combinedArea = Perimeter(Union(node.box, leafBox));
+
+        // Cost of a new parent for this node and the leaf, and the growth every deeper choice inherits
+        const float cost = 2.0f * combinedArea;
+        const float inheritance = 2.0f * (combinedArea - area);
+
+        float childCost[2];
+        const uint32_t children[2] = { node.child1, node.child2 };
+        for (int c = 0; c < 2; ++c)
+        {
+            const Node& child = m_nodes[children[c]];
+            const float grown = Perimeter(Union(child.box, leafBox));
+            childCost[c] = (IsLeaf(children[c]) ? grown : grown - Perimeter(child.box)) + inheritance;
+        }
+
+        if (cost < childCost[0] && cost < childCost[1])
+            break;
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    const uint32_t sibling = index;
+    const uint32_t oldParent = m_nodes[sibling].parent;
+    const uint32_t newParent = AllocateNode();
+
+    Node& parent = m_nodes[newParent];
+    parent.parent = oldParent;
+    parent.box = Union(leafBox, m_nodes[sibling].box);
+    parent.height = m_nodes[sibling].height + 1;
+    parent.child1 = sibling;
+    parent.child2 = leaf;
+
+    if (oldParent != NONE)
+    {
+        if (m_nodes[oldParent].child1 == sibling)
+            m_nodes[oldParent].child1 = newParent;
+        else
+            m_nodes[oldParent].child2 = newParent;
+    }
+    else
+        m_root = newParent;
+
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    Refit(newParent);
+}
+
+// The leaf's parent is dropped and the sibling takes its place.
+
+void DynamicAABBTree::RemoveLeaf(uint32_t leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NONE;
+        return;
+    }
+
+    const uint32_t parent = m_nodes[leaf].parent;
+    const uint32_t grandParent = m_nodes[parent].parent;
+    const uint32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent != NONE)
+    {
+        if (m_nodes[grandParent].child1 == parent)
+            m_nodes[grandParent].child1 = sibling;
+        else
+            m_nodes[grandParent].child2 = sibling;
+        m_nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+        Refit(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NONE;
+        FreeNode(parent);
+    }
+}
+
+void DynamicAABBTree::Refit(uint32_t node)
+{
+    while (node != NONE)
+    {
+        node = Balance(node);
+
+        Node& n = m_nodes[node];
+        const Node& child1 = m_nodes[n.child1];
+        const Node& child2 = m_nodes[n.child2];
+        n.height = 1 + std::max(child1.height, child2.height);
+        n.box = Union(child1.box, child2.box);
+
+        node = n.parent;
+    }
+}
+
+// Standard AVL-style rotation for a BVH.  With A the node, B and C its children, if C is two or more levels taller it
+// is rotated up to replace A, and A keeps whichever of C's children (F or G) is shorter; the mirror case promotes B.
+
+uint32_t DynamicAABBTree::Balance(uint32_t iA)
+{
+    Node& A = m_nodes[iA];
+    if (IsLeaf(iA) || A.height < 2)
+        return iA;
+
+    const uint32_t iB = A.child1;
+    const uint32_t iC = A.child2;
+    Node& B = m_nodes[iB];
+    Node& C = m_nodes[iC];
+
+    const int32_t balance = C.height - B.height;
+
+    // Rotate C up
+    if (balance > 1)
+    {
+        const uint32_t iF = C.child1;
+        const uint32_t iG = C.child2;
+        Node& F = m_nodes[iF];
+        Node& G = m_nodes[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+
+        if (C.parent != NONE)
+        {
+            if (m_nodes[C.parent].child1 == iA)
+                m_nodes[C.parent].child1 = iC;
+            else
+                m_nodes[C.parent].child2 = iC;
+        }
+        else
+            m_root = iC;
+
+        if (F.height > G.height)
+        {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.box = Union(B.box, G.box);
+            C.box = Union(A.box, F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        }
+        else
+        {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.box = Union(B.box, F.box);
+            C.box = Union(A.box, G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    // Rotate B up
+    if (balance < -1)
+    {
+        const uint32_t iD = B.child1;
+        const uint32_t iE = B.child2;
+        Node& D = m_nodes[iD];
+        Node& E = m_nodes[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+
+        if (B.parent != NONE)
+        {
+            if (m_nodes[B.parent].child1 == iA)
+                m_nodes[B.parent].child1 = iB;
+            else
+                m_nodes[B.parent].child2 = iB;
+        }
+        else
+            m_root = iB;
+
+        if (D.height > E.height)
+        {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.box = Union(C.box, E.box);
+            B.box = Union(A.box, D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        }
+        else
+        {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.box = Union(C.box, D.box);
+            B.box = Union(A.box, E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+void DynamicAABBTree::Build(CritterStore& critters)
+{
+    m_store = &critters;
+    const uint32_t count = static_cast<uint32_t>(critters.Size());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        CritterView critter = critters.Get(i);
+        if (!critters.IsAlive(i))
+        {
+            Remove(critter);
+            continue;
+        }
+
+        const Vector2 position = critters.GetPosition(i);
+        const float radius = critters.GetRadius(i);
+        if (!Update(critter, position, radius))
+            Insert(critter, position, radius);
+    }
+}
+
+bool DynamicAABBTree::Insert(CritterView critter, const Vector2& position, float radius)
+{
+    if (Update(critter, position, radius))
+        return true;
+
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_leafOf.size())
+        m_leafOf.resize(index + 1, NONE);
+    m_store = critter.GetStore();
+
+    const uint32_t leaf = AllocateNode();
+    Node& node = m_nodes[leaf];
+    const float fat = radius + m_fatMargin;
+    node.box = Box{ position.x - fat, position.y - fat, position.x + fat, position.y + fat };
+    node.item = index;
+    node.x = position.x;
+    node.y = position.y;
+    node.radius = radius;
+
+    m_leafOf[index] = leaf;
+    InsertLeaf(leaf);
+    return true;
+}
+
+// Most moves stay inside the fat box and only the stored circle changes.
+
+bool DynamicAABBTree::Update(CritterView critter, const Vector2& position, float radius)
+{
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_leafOf.size() || m_leafOf[index] == NONE)
+        return false;
+
+    const uint32_t leaf = m_leafOf[index];
+    Node& node = m_nodes[leaf];
+    node.x = position.x;
+    node.y = position.y;
+    node.radius = radius;
+
+    const Box tight{ position.x - radius, position.y - radius, position.x + radius, position.y + radius };
+    if (ContainsBox(node.box, tight))
+        return true;
+
+    RemoveLeaf(leaf);
+    const float fat = radius + m_fatMargin;
+    m_nodes[leaf].box = Box{ position.x - fat, position.y - fat, position.x + fat, position.y + fat };
+    InsertLeaf(leaf);
+    return true;
+}
+
+bool DynamicAABBTree::Remove(CritterView critter)
+{
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_leafOf.size() || m_leafOf[index] == NONE)
+        return false;
+
+    const uint32_t leaf = m_leafOf[index];
+    RemoveLeaf(leaf);
+    FreeNode(leaf);
+    m_leafOf[index] = NONE;
+    return true;
+}
+
+template <typename Visitor>
+void DynamicAABBTree::VisitLeaves(const Box& box, Visitor visit) const
+{
+    if (m_root == NONE)
+        return;
+
+    uint32_t stack[MAX_STACK];
+    int pending = 0;
+    stack[pending++] = m_root;
+
+    while (pending > 0)
+    {
+        const uint32_t index = stack[--pending];
+        const Node& node = m_nodes[index];
+        if (!Overlaps(node.box, box))
+            continue;
+
+        if (node.child1 == NONE)
+        {
+            visit(index);
+            continue;
+        }
+
+        assert(pending + 2 <= MAX_STACK);
+        stack[pending++] = node.child1;
+        stack[pending++] = node.child2;
+    }
+}
+
+void DynamicAABBTree::Query(const AABB& range, ArenaVector<CritterView>& outResults) const
+{
+    const Rectangle& r = range.bounds;
+    const Box box{ r.x, r.y, r.x + r.width, r.y + r.height };
+    VisitLeaves(box, [&](uint32_t leaf)
+    {
+        const Node& n = m_nodes[leaf];
+        if (n.x >= box.minX && n.x <= box.maxX && n.y >= box.minY && n.y <= box.maxY)
+            outResults.push_back(m_store->Get(n.item));
+    });
+}
+
+void DynamicAABBTree::QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const
+{
+    const Box box{ centre.x - radius, centre.y - radius, centre.x + radius, centre.y + radius };
+    VisitLeaves(box, [&](uint32_t leaf)
+    {
+        const Node& n = m_nodes[leaf];
+        const float dx = n.x - centre.x;
+        const float dy = n.y - centre.y;
+        const float touch = radius + n.radius;
+        if (dx * dx + dy * dy <= touch * touch)
+            outResults.push_back(m_store->Get(n.item));
+    });
+}
+
+// Self-traversal of the tree: every internal node reports the pairs inside each child and then the pairs across its two
+// children, and a cross test only descends while the two boxes overlap.  Each pair is reached exactly once, with no
+// per-leaf query and no index filtering.
+
+void DynamicAABBTree::QueryPairs(PairCallback onPair) const
+{
+    if (m_root != NONE)
+        PairsWithin(m_root, onPair);
+}
+
+void DynamicAABBTree::PairsWithin(uint32_t node, const PairCallback& onPair) const
+{
+    const Node& n = m_nodes[node];
+    if (n.child1 == NONE)
+        return;
+
+    PairsWithin(n.child1, onPair);
+    PairsWithin(n.child2, onPair);
+    PairsAcross(n.child1, n.child2, onPair);
+}
+
+// Descend into the taller side (or the one that isn't a leaf) until both are leaves, then run the exact circle test.
+
+void DynamicAABBTree::PairsAcross(uint32_t a, uint32_t b, const PairCallback& onPair) const
+{
+    const Node& na = m_nodes[a];
+    const Node& nb = m_nodes[b];
+    if (!Overlaps(na.box, nb.box))
+        return;
+
+    if (na.child1 == NONE && nb.child1 == NONE)
+    {
+        const float dx = nb.x - na.x;
+        const float dy = nb.y - na.y;
+        const float touch = na.radius + nb.radius;
+        if (dx * dx + dy * dy > touch * touch)
+            return;
+
+        if (na.item < nb.item)
+            onPair(m_store->Get(na.item), m_store->Get(nb.item));
+        else
+            onPair(m_store->Get(nb.item), m_store->Get(na.item));
+        return;
+    }
+
+    if (nb.child1 == NONE || (na.child1 != NONE && na.height >= nb.height))
+    {
+        PairsAcross(na.child1, b, onPair);
+        PairsAcross(na.child2, b, onPair);
+    }
+    else
+    {
+        PairsAcross(a, nb.child1, onPair);
+        PairsAcross(a, nb.child2, onPair);
+    }
+}
+
+void DynamicAABBTree::Clear()
+{
+    for (uint32_t node = 0; node < m_nodes.size(); ++node)
+    {
+        if (m_nodes[node].height == 0)
+            m_leafOf[m_nodes[node].item] = NONE;
+    }
+    m_nodes.clear();
+    m_root = NONE;
+    m_freeList = NONE;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "SpatialIndex.h"
+#include <cstdint>
+#include <vector>
+
+// Dynamic bounding-volume hierarchy for bodies of very different sizes.
+//
+// Every critter is a leaf whose box is its circle's bounds fattened by a margin, so small moves
+// don't touch the tree at all.  When a critter leaves its fat box the leaf is removed and
+// re-inserted: the new sibling is picked by a surface-area style cost (perimeter in 2D), then the
+// ancestors are refitted on the way back up and rotated AVL-style wherever one side is more than
+// one level taller than the other.  Unlike the quadtree, a large body sits in one leaf sized to
+// it, and small bodies around it aren't penalised by its radius.
+//
+// Nodes live in one array with a free list, so after warm-up nothing is allocated.
+
+class DynamicAABBTree : public ISpatialIndex
+{
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+    static const int      MAX_STACK = 128;   // Traversal stack; AVL balance keeps height far below this
+
+    struct Box
+    {
+        float minX, minY, maxX, maxY;
+    };
+
+    struct Node
+    {
+        Box      box;       // Fat box for leaves, union of the children for internal nodes
+        uint32_t parent;    // Also the next link while on the free list
+        uint32_t child1;    // NONE for leaves
+        uint32_t child2;
+        int32_t  height;    // 0 for leaves, -1 while free
+        uint32_t item;      // Critter index (leaves only)
+        float    x, y;      // Circle captured at Insert/Update (leaves only)
+        float    radius;
+    };
+
+    std::vector<Node>     m_nodes;
+    uint32_t              m_root;
+    uint32_t              m_freeList;
+    std::vector<uint32_t> m_leafOf;      // Critter index -> leaf node, or NONE
+    CritterStore*         m_store;
+    float                 m_fatMargin;
+
+    bool IsLeaf(uint32_t node) const { return m_nodes[node].child1 == NONE; }
+
+    uint32_t AllocateNode();
+    void     FreeNode(uint32_t node);
+
+    void InsertLeaf(uint32_t leaf);
+    void RemoveLeaf(uint32_t leaf);
+
+    // Refit boxes and heights from 'node' to the root, rebalancing as it goes
+    void Refit(uint32_t node);
+
+    // Rotate the taller grandchild up if the subtree at 'node' is unbalanced; returns the subtree's new root
+    uint32_t Balance(uint32_t node);
+
+    // Pairs between leaves under one node, and between the leaves of two disjoint subtrees
+    void PairsWithin(uint32_t node, const PairCallback& onPair) const;
+    void PairsAcross(uint32_t a, uint32_t b, const PairCallback& onPair) const;
+
+    // Call visit(leaf) for every leaf whose fat box overlaps 'box'
+    template <typename Visitor>
+    void VisitLeaves(const Box& box, Visitor visit) const;
+
+public:
+    // fatMargin: how far a critter may move before its leaf is re-inserted
+    explicit DynamicAABBTree(float fatMargin = 4.0f);
+
+    // Update, insert or remove every critter to match the store
+    void Build(CritterStore& critters) override;
+
+    bool Insert(CritterView critter, const Vector2& position, float radius) override;
+
+    // Refit on move: only re-inserts the leaf when the circle leaves its fat box
+    bool Update(CritterView critter, const Vector2& position, float radius) override;
+    bool Remove(CritterView critter) override;
+
+    void Query(const AABB& range, ArenaVector<CritterView>& outResults) const override;
+    void QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const override;
+    void QueryPairs(PairCallback onPair) const override;
+
+    void Clear() override;
+
+    // Height of the tree (0 for a single leaf, -1 when empty)
+    int GetHeight() const { return m_root == NONE ? -1 : m_nodes[m_root].height; }
+};
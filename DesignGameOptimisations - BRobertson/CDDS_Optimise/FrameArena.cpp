@@ -0,0 +1,74 @@
+#include "FrameArena.h"
+#include <cstdint>
+
+FrameArena::FrameArena(size_t initialCapacity)
+    : m_offset(0)
+    , m_used(0)
+{
+    m_blocks.reserve(8);
+    AddBlock(initialCapacity > 0 ? initialCapacity : 1);
+}
+
+FrameArena::~FrameArena()
+{
+    for (Block& block : m_blocks)
+        ::operator delete(block.data);
+}
+
+void FrameArena::AddBlock(size_t size)
+{
+    Block block;
+    block.data = static_cast<unsigned char*>(::operator new(size));
+    block.size = size;
+    m_blocks.push_back(block);
+    m_offset = 0;
+}
+
+// Align the bump pointer, and chain a new block (at least double the last) if the request doesn't fit.
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    Block* block = &m_blocks.back();
+    uintptr_t base = reinterpret_cast<uintptr_t>(block->data);
+    uintptr_t aligned = (base + m_offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+
+    if (aligned + size > base + block->size)
+    {
+        size_t grow = block->size * 2;
+        AddBlock(grow > size + alignment ? grow : size + alignment);
+
+        block = &m_blocks.back();
+        base = reinterpret_cast<uintptr_t>(block->data);
+        aligned = (base + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    }
+
+    m_offset = (aligned - base) + size;
+    m_used += size;
+    return reinterpret_cast<void*>(aligned);
+}
+
+// Rewind to the start.  If last frame needed several blocks, replace them with one block big
+// enough for all of them so the next frame fits without growing.
+
+void FrameArena::Reset()
+{
+    if (m_blocks.size() > 1)
+    {
+        size_t total = GetCapacity();
+        for (Block& block : m_blocks)
+            ::operator delete(block.data);
+        m_blocks.clear();
+        AddBlock(total);
+    }
+
+    m_offset = 0;
+    m_used = 0;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+    size_t total = 0;
+    for (const Block& block : m_blocks)
+        total += block.size;
+    return total;
+}
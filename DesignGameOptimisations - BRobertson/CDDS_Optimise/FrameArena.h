@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Linear (bump) allocator for transient data that only lives for one frame.  Allocation is a
+// pointer bump, nothing is freed individually and Reset() at the start of a frame recycles
+// everything at once.  If a frame overflows the first block, extra blocks are chained and then
+// merged into one bigger block on the next Reset, so after warm-up a frame makes no heap calls.
+
+class FrameArena
+{
+private:
+    struct Block
+    {
+        unsigned char* data;
+        size_t         size;
+    };
+
+    std::vector<Block> m_blocks;   // Last block is the one being bumped
+    size_t             m_offset;   // Bytes used in the last block
+    size_t             m_used;     // Bytes handed out this frame, across all blocks
+
+    void AddBlock(size_t size);
+
+public:
+    explicit FrameArena(size_t initialCapacity = 64 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Bump-allocate 'size' bytes; never returns null
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Recycle every allocation made since the last Reset
+    void Reset();
+
+    size_t GetUsed() const { return m_used; }
+    size_t GetCapacity() const;
+};
+
+// STL allocator that takes memory from a FrameArena; deallocate is a no-op.  A default-constructed
+// allocator (no arena) falls back to the global heap, so containers of this type work either way.
+
+template <typename T>
+class ArenaAllocator
+{
+private:
+    FrameArena* m_arena;
+
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept : m_arena(nullptr) {}
+    explicit ArenaAllocator(FrameArena* arena) noexcept : m_arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.GetArena()) {}
+
+    T* allocate(size_t count)
+    {
+        if (m_arena)
+            return static_cast<T*>(m_arena->Allocate(count * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t) noexcept
+    {
+        if (!m_arena)
+            ::operator delete(pointer);
+    }
+
+    FrameArena* GetArena() const { return m_arena; }
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.GetArena() == b.GetArena(); }
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.GetArena() != b.GetArena(); }
+
+// Vector whose storage comes from a FrameArena (or the heap without one)
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
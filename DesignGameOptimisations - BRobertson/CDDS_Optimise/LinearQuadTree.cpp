@@ -0,0 +1,338 @@
+#include "LinearQuadTree.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+const uint32_t LinearQuadTree::NONE;  // Bound to a const reference by vector::resize
+
+namespace
+{
+    // Spread the low 16 bits of v so there is a zero between each (abcd -> 0a0b0c0d)
+    inline uint32_t SpreadBits(uint32_t v)
+    {
+        v &= 0x0000FFFFu;
+        v = (v | (v << 8)) & 0x00FF00FFu;
+        v = (v | (v << 4)) & 0x0F0F0F0Fu;
+        v = (v | (v << 2)) & 0x33333333u;
+        v = (v | (v << 1)) & 0x55555555u;
+        return v;
+    }
+
+    // Split [0, count) into 'threads' contiguous chunks and run fn(begin, end, thread) on each, the first on the
+    // calling thread and the rest on the pool's workers.  The split only depends on count and threads, so two calls
+    // see the same chunks.
+    template <typename Fn>
+    void ParallelFor(WorkerPool& pool, size_t count, unsigned threads, Fn fn)
+    {
+        auto chunk = [&](unsigned t) { fn(count * t / threads, count * (t + 1) / threads, t); };
+        pool.Run(threads, chunk);
+    }
+}
+
+LinearQuadTree::LinearQuadTree(const AABB& world, unsigned threads)
+    : m_world(world)
+    , m_scaleX(world.bounds.width > 0.0f ? 65536.0f / world.bounds.width : 0.0f)
+    , m_scaleY(world.bounds.height > 0.0f ? 65536.0f / world.bounds.height : 0.0f)
+    , m_slack(std::max(world.bounds.width, world.bounds.height) / 65536.0f)
+    , m_threads(1)
+    , m_store(nullptr)
+    , m_maxRadius(0.0f)
+{
+    SetThreadCount(threads);
+}
+
+void LinearQuadTree::SetThreadCount(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    m_threads = threads > 0 ? threads : 1;
+    m_histograms.assign(static_cast<size_t>(m_threads) * 256, 0);
+}
+
+// Quantise to the 16-bit grid (clamping anything outside the world onto its edge) and interleave, x in the even bits.
+
+uint32_t LinearQuadTree::MortonCode(const Vector2& position) const
+{
+    const float fx = (position.x - m_world.bounds.x) * m_scaleX;
+    const float fy = (position.y - m_world.bounds.y) * m_scaleY;
+    const uint32_t qx = fx <= 0.0f ? 0u : (fx >= 65535.0f ? 65535u : static_cast<uint32_t>(fx));
+    const uint32_t qy = fy <= 0.0f ? 0u : (fy >= 65535.0f ? 65535u : static_cast<uint32_t>(fy));
+    return SpreadBits(qx) | (SpreadBits(qy) << 1);
+}
+
+// Four 8-bit passes over the code half of each key.  Each thread counts its own chunk, the per-thread counts are turned
+// into per-thread write offsets (bucket-major, thread-minor, which keeps the sort stable), then each thread scatters its
+// chunk.  A pass where every key has the same digit (e.g. everything in one corner of the world) is skipped.
+
+void LinearQuadTree::RadixSort()
+{
+    const size_t count = m_keys.size();
+    m_scratch.resize(count);
+    const unsigned threads = count >= PARALLEL_MIN ? m_threads : 1;
+
+    uint64_t* source = m_keys.data();
+    uint64_t* target = m_scratch.data();
+    size_t* histograms = m_histograms.data();
+
+    for (int shift = 32; shift < 64; shift += 8)
+    {
+        ParallelFor(m_workers, count, threads, [=](size_t begin, size_t end, unsigned t)
+        {
+            size_t* histogram = histograms + t * 256;
+            std::fill(histogram, histogram + 256, size_t(0));
+            for (size_t i = begin; i < end; ++i)
+                ++histogram[(source[i] >> shift) & 0xFF];
+        });
+
+        bool trivial = false;
+        size_t running = 0;
+        for (int digit = 0; digit < 256 && !trivial; ++digit)
+        {
+            size_t total = 0;
+            for (unsigned t = 0; t < threads; ++t)
+                total += histograms[t * 256 + digit];
+            trivial = total == count;
+        }
+        if (trivial)
+            continue;
+
+        for (int digit = 0; digit < 256; ++digit)
+        {
+            for (unsigned t = 0; t < threads; ++t)
+            {
+                const size_t c = histograms[t * 256 + digit];
+                histograms[t * 256 + digit] = running;
+                running += c;
+            }
+        }
+
+        ParallelFor(m_workers, count, threads, [=](size_t begin, size_t end, unsigned t)
+        {
+            size_t* offsets = histograms + t * 256;
+            for (size_t i = begin; i < end; ++i)
+                target[offsets[(source[i] >> shift) & 0xFF]++] = source[i];
+        });
+
+        std::swap(source, target);
+    }
+
+    if (source != m_keys.data())
+        m_keys.swap(m_scratch);
+}
+
+void LinearQuadTree::Gather(CritterStore& critters)
+{
+    const size_t count = m_keys.size();
+    m_x.resize(count);
+    m_y.resize(count);
+    m_radius.resize(count);
+    if (m_sortedOf.size() < critters.Size())
+        m_sortedOf.resize(critters.Size(), NONE);
+
+    const unsigned threads = count >= PARALLEL_MIN ? m_threads : 1;
+    ParallelFor(m_workers, count, threads, [&](size_t begin, size_t end, unsigned)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const uint32_t index = static_cast<uint32_t>(m_keys[i]);
+            m_x[i] = critters.GetX(index);
+            m_y[i] = critters.GetY(index);
+            m_radius[i] = critters.GetRadius(index);
+            m_sortedOf[index] = static_cast<uint32_t>(i);
+        }
+    });
+}
+
+void LinearQuadTree::Build(CritterStore& critters)
+{
+    Clear();
+    m_store = &critters;
+
+    const uint32_t count = static_cast<uint32_t>(critters.Size());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!critters.IsAlive(i))
+            continue;
+        m_keys.push_back((static_cast<uint64_t>(MortonCode(critters.GetPosition(i))) << 32) | i);
+        m_maxRadius = std::max(m_maxRadius, critters.GetRadius(i));
+    }
+
+    RadixSort();
+    Gather(critters);
+}
+
+uint32_t LinearQuadTree::LowerBound(uint32_t first, uint32_t last, uint64_t code) const
+{
+    auto it = std::lower_bound(m_keys.begin() + first, m_keys.begin() + last, code,
+        [](uint64_t key, uint64_t c) { return (key >> 32) < c; });
+    return static_cast<uint32_t>(it - m_keys.begin());
+}
+
+void LinearQuadTree::InsertAt(uint32_t at, uint64_t key, const Vector2& position, float radius)
+{
+    m_keys.insert(m_keys.begin() + at, key);
+    m_x.insert(m_x.begin() + at, position.x);
+    m_y.insert(m_y.begin() + at, position.y);
+    m_radius.insert(m_radius.begin() + at, radius);
+    for (uint32_t i = at; i < m_keys.size(); ++i)
+        m_sortedOf[static_cast<uint32_t>(m_keys[i])] = i;
+}
+
+bool LinearQuadTree::Insert(CritterView critter, const Vector2& position, float radius)
+{
+    if (Update(critter, position, radius))
+        return true;
+
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_sortedOf.size())
+        m_sortedOf.resize(index + 1, NONE);
+    m_store = critter.GetStore();
+    m_maxRadius = std::max(m_maxRadius, radius);
+
+    const uint32_t code = MortonCode(position);
+    const uint32_t count = static_cast<uint32_t>(m_keys.size());
+    InsertAt(LowerBound(0, count, code), (static_cast<uint64_t>(code) << 32) | index, position, radius);
+    return true;
+}
+
+bool LinearQuadTree::Update(CritterView critter, const Vector2& position, float radius)
+{
+    if (!Remove(critter))
+        return false;
+    return Insert(critter, position, radius);
+}
+
+bool LinearQuadTree::Remove(CritterView critter)
+{
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_sortedOf.size() || m_sortedOf[index] == NONE)
+        return false;
+
+    const uint32_t at = m_sortedOf[index];
+    m_keys.erase(m_keys.begin() + at);
+    m_x.erase(m_x.begin() + at);
+    m_y.erase(m_y.begin() + at);
+    m_radius.erase(m_radius.begin() + at);
+    for (uint32_t i = at; i < m_keys.size(); ++i)
+        m_sortedOf[static_cast<uint32_t>(m_keys[i])] = i;
+    m_sortedOf[index] = NONE;
+    return true;
+}
+
+// Depth-first over the implicit tree with a fixed stack (each level leaves at most three siblings waiting).  A cell's
+// children split its run at three binary-searched points; short runs and full-depth cells are scanned directly.
+
+template <typename Visitor>
+void LinearQuadTree::VisitCells(float minX, float minY, float maxX, float maxY, float margin, Visitor visit) const
+{
+    struct Cell
+    {
+        uint32_t first, last;   // Run in the sorted arrays
+        uint32_t code;          // Morton prefix of the cell (2 * depth bits)
+        uint32_t cellX, cellY;  // Cell coordinates at this depth
+        int      depth;
+    };
+
+    const float infinity = std::numeric_limits<float>::infinity();
+    const float grow = margin + m_slack;
+
+    Cell stack[MAX_DEPTH * 3 + 1];
+    int pending = 0;
+    stack[pending++] = Cell{ 0, static_cast<uint32_t>(m_keys.size()), 0, 0, 0, 0 };
+
+    while (pending > 0)
+    {
+        const Cell cell = stack[--pending];
+        if (cell.first == cell.last)
+            continue;
+
+        // Cell bounds, open-ended on the world's outer edges
+        const uint32_t cells = 1u << cell.depth;
+        const float width = m_world.bounds.width / cells;
+        const float height = m_world.bounds.height / cells;
+        const float left = cell.cellX == 0 ? -infinity : m_world.bounds.x + cell.cellX * width;
+        const float right = cell.cellX == cells - 1 ? infinity : m_world.bounds.x + (cell.cellX + 1) * width;
+        const float top = cell.cellY == 0 ? -infinity : m_world.bounds.y + cell.cellY * height;
+        const float bottom = cell.cellY == cells - 1 ? infinity : m_world.bounds.y + (cell.cellY + 1) * height;
+        if (left - grow > maxX || right + grow < minX || top - grow > maxY || bottom + grow < minY)
+            continue;
+
+        if (cell.last - cell.first <= LEAF_SIZE || cell.depth == MAX_DEPTH)
+        {
+            for (uint32_t i = cell.first; i < cell.last; ++i)
+                visit(i);
+            continue;
+        }
+
+        // Children in Z order: NW, NE, SW, SE.  Pushed in reverse so NW is visited first.
+        const int shift = 2 * (MAX_DEPTH - cell.depth - 1);
+        uint32_t bounds[5];
+        bounds[0] = cell.first;
+        bounds[4] = cell.last;
+        for (uint32_t q = 1; q < 4; ++q)
+            bounds[q] = LowerBound(bounds[q - 1], cell.last, static_cast<uint64_t>(cell.code * 4 + q) << shift);
+
+        for (int q = 3; q >= 0; --q)
+        {
+            stack[pending++] = Cell{ bounds[q], bounds[q + 1], cell.code * 4 + static_cast<uint32_t>(q),
+                cell.cellX * 2 + (q & 1), cell.cellY * 2 + (q >> 1), cell.depth + 1 };
+        }
+    }
+}
+
+void LinearQuadTree::Query(const AABB& range, ArenaVector<CritterView>& outResults) const
+{
+    const Rectangle& r = range.bounds;
+    VisitCells(r.x, r.y, r.x + r.width, r.y + r.height, 0.0f, [&](uint32_t i)
+    {
+        if (m_x[i] >= r.x && m_x[i] <= r.x + r.width && m_y[i] >= r.y && m_y[i] <= r.y + r.height)
+            outResults.push_back(m_store->Get(static_cast<uint32_t>(m_keys[i])));
+    });
+}
+
+void LinearQuadTree::QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const
+{
+    VisitCells(centre.x - radius, centre.y - radius, centre.x + radius, centre.y + radius, m_maxRadius, [&](uint32_t i)
+    {
+        const float dx = m_x[i] - centre.x;
+        const float dy = m_y[i] - centre.y;
+        const float touch = radius + m_radius[i];
+        if (dx * dx + dy * dy <= touch * touch)
+            outResults.push_back(m_store->Get(static_cast<uint32_t>(m_keys[i])));
+    });
+}
+
+// A circle query per item in Morton order (so consecutive queries touch the same cells), keeping only partners with a
+// higher critter index.
+
+void LinearQuadTree::QueryPairs(PairCallback onPair) const
+{
+    for (uint32_t a = 0; a < m_keys.size(); ++a)
+    {
+        const uint32_t indexA = static_cast<uint32_t>(m_keys[a]);
+        const float x = m_x[a], y = m_y[a], radius = m_radius[a];
+        VisitCells(x - radius, y - radius, x + radius, y + radius, m_maxRadius, [&](uint32_t b)
+        {
+            const uint32_t indexB = static_cast<uint32_t>(m_keys[b]);
+            if (indexB <= indexA)
+                return;
+
+            const float dx = m_x[b] - x;
+            const float dy = m_y[b] - y;
+            const float touch = radius + m_radius[b];
+            if (dx * dx + dy * dy <= touch * touch)
+                onPair(m_store->Get(indexA), m_store->Get(indexB));
+        });
+    }
+}
+
+void LinearQuadTree::Clear()
+{
+    for (uint64_t key : m_keys)
+        m_sortedOf[static_cast<uint32_t>(key)] = NONE;
+    m_keys.clear();
+    m_x.clear();
+    m_y.clear();
+    m_radius.clear();
+    m_maxRadius = 0.0f;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "SpatialIndex.h"
+#include "WorkerPool.h"
+#include <cstdint>
+#include <vector>
+
+// Linear (pointerless) quadtree built by sorting Morton codes.
+//
+// Each critter's position is quantised to 16 bits per axis inside the world and the bits are
+// interleaved into a 32-bit Morton (Z-order) code.  Sorting the codes with an LSD radix sort puts
+// every quadtree cell's critters in one contiguous run, so no nodes are stored at all: a cell at
+// depth d is the run of codes sharing its top 2d bits, found by binary search inside its parent's
+// run.  Build is O(n) and the radix sort's histogram and scatter passes split across threads,
+// which the tree keeps parked between Builds.
+// Positions and radii are gathered into sorted SoA arrays so queries scan contiguous memory.
+//
+// Cells on the world edge reach to infinity on their outer sides, so positions outside the world
+// (clamped into edge cells) are still found.  Insert/Update/Remove keep the arrays sorted but are
+// O(n); the index is meant to be rebuilt with Build every frame.
+
+class LinearQuadTree : public ISpatialIndex
+{
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+    static const int      MAX_DEPTH = 16;       // 16 bits per axis
+    static const uint32_t LEAF_SIZE = 128;      // Runs this short are scanned instead of split (contiguous scans are cheap)
+    static const size_t   PARALLEL_MIN = 32768; // Smaller builds sort on the calling thread
+
+    AABB                  m_world;
+    float                 m_scaleX;             // World units -> 16-bit grid
+    float                 m_scaleY;
+    float                 m_slack;              // One grid step, covers rounding at cell edges
+    unsigned              m_threads;
+    WorkerPool            m_workers;            // Sorting threads, kept between Builds
+
+    // Sorted by Morton code
+    std::vector<uint64_t> m_keys;               // Code in the high 32 bits, critter index in the low 32
+    std::vector<float>    m_x;
+    std::vector<float>    m_y;
+    std::vector<float>    m_radius;
+
+    std::vector<uint64_t> m_scratch;            // Radix sort ping-pong buffer
+    std::vector<size_t>   m_histograms;         // 256 counters per sorting thread
+    std::vector<uint32_t> m_sortedOf;           // Critter index -> position in the sorted arrays, or NONE
+    CritterStore*         m_store;
+    float                 m_maxRadius;
+
+    uint32_t MortonCode(const Vector2& position) const;
+
+    // Stable LSD radix sort of m_keys on the code bits, 8 bits per pass
+    void RadixSort();
+
+    // Refill m_x/m_y/m_radius/m_sortedOf from the store in sorted order
+    void Gather(CritterStore& critters);
+
+    // Insert one sorted entry at 'at', shifting the rest up
+    void InsertAt(uint32_t at, uint64_t key, const Vector2& position, float radius);
+
+    // First sorted position in [first, last) whose code is >= code
+    uint32_t LowerBound(uint32_t first, uint32_t last, uint64_t code) const;
+
+    // Walk the implicit tree, calling visit(sortedPosition) for every item in a cell that overlaps the
+    // box [minX, maxX] x [minY, maxY] grown by 'margin'
+    template <typename Visitor>
+    void VisitCells(float minX, float minY, float maxX, float maxY, float margin, Visitor visit) const;
+
+public:
+    // threads = 0 uses every hardware thread for large builds
+    LinearQuadTree(const AABB& world, unsigned threads = 0);
+
+    // Recompute codes for every live critter, radix sort and gather
+    void Build(CritterStore& critters) override;
+
+    bool Insert(CritterView critter, const Vector2& position, float radius) override;
+    bool Update(CritterView critter, const Vector2& position, float radius) override;
+    bool Remove(CritterView critter) override;
+
+    void Query(const AABB& range, ArenaVector<CritterView>& outResults) const override;
+    void QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const override;
+    void QueryPairs(PairCallback onPair) const override;
+
+    void Clear() override;
+
+    void     SetThreadCount(unsigned threads);
+    unsigned GetThreadCount() const { return m_threads; }
+};
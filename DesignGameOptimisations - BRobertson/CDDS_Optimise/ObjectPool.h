@@ -1,81 +1,237 @@
 #pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
 #include <vector>
 
-template <typename T>
+// 32-bit reference to a pooled object: the low INDEX_BITS are the slot index and the high bits are
+// the slot's generation.  The generation is bumped every time the object goes back to the pool, so
+// a handle kept after Return() no longer resolves and cannot be returned a second time.
+// Generations start at 1, so a default-constructed handle never resolves.
+//
+// Wrap window: the generation has 12 bits and skips 0, so it repeats after 4095 Returns of the same
+// slot.  A stale handle held across exactly that many reuses of its slot would validate again; one
+// held for fewer reuses (the normal case, e.g. a double Return) is always rejected.
+struct PoolHandle
+{
+    static const uint32_t INDEX_BITS = 20;                         // Up to ~1M objects per pool
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    uint32_t value = 0;
+
+    PoolHandle() = default;
+    PoolHandle(uint32_t index, uint32_t generation) : value((generation << INDEX_BITS) | index) {}
+
+    uint32_t Index() const { return value & INDEX_MASK; }
+    uint32_t Generation() const { return value >> INDEX_BITS; }
+
+    bool operator==(const PoolHandle& other) const { return value == other.value; }
+    bool operator!=(const PoolHandle& other) const { return value != other.value; }
+};
+
+// Pool of reusable objects stored in contiguous slabs of CHUNK_SIZE.  Growing adds a whole slab
+// so existing objects never move, and iterating live objects is a linear scan over each slab.
+
+template <typename T, size_t CHUNK_SIZE = 256>
 class ObjectPool
 {
+    static_assert(CHUNK_SIZE > 0 && (CHUNK_SIZE & (CHUNK_SIZE - 1)) == 0, "CHUNK_SIZE must be a power of two");
+
 private:
-    std::vector<T*> m_pool;       // All created objects
-    std::vector<T*> m_available;  // Currently available (unused) objects
+    static const size_t WORDS_PER_CHUNK = (CHUNK_SIZE + 63) / 64;
+
+    // One slab: the objects themselves plus per-slot generation and in-use bits
+    struct Chunk
+    {
+        T        objects[CHUNK_SIZE];
+        uint32_t generations[CHUNK_SIZE];
+        uint64_t inUse[WORDS_PER_CHUNK];
+    };
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;     // All created slabs
+    std::vector<uint32_t>               m_available;  // Indices of currently available (unused) objects
+    size_t                              m_rejectedReturns = 0;
+
+    static size_t   ChunkOf(uint32_t index) { return index / CHUNK_SIZE; }
+    static size_t   SlotOf(uint32_t index) { return index & (CHUNK_SIZE - 1); }
+    static uint64_t BitOf(size_t slot) { return uint64_t(1) << (slot & 63); }
+
+    bool InUse(uint32_t index) const
+    {
+        const Chunk& chunk = *m_chunks[ChunkOf(index)];
+        return (chunk.inUse[SlotOf(index) >> 6] & BitOf(SlotOf(index))) != 0;
+    }
+
+    // Allocate one more slab and mark its objects available.  Returns false if the handle index space is full.
+    bool Grow();
 
 public:
-    // Create 'initialSize' objects and mark all as available
+    // Create enough slabs for 'initialSize' objects and mark all as available
     ObjectPool(size_t initialSize);
-    ~ObjectPool();
 
-    // Acquire an object: either reuse or allocate a new one
-    T* Get();
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
 
-    // Return an object back to the pool for later reuse
-    void Return(T* object);
+    // Acquire an object: either reuse or allocate a new slab.  Returns an invalid handle only when
+    // the pool already holds the maximum number of objects a handle can address.
+    PoolHandle Get();
 
-    // Reset pool: mark every object as available again
+    // Object for a handle, or nullptr if the handle is stale (already returned)
+    T* Resolve(PoolHandle handle) const;
+
+    // Unchecked access for handles known to be live: one shift/mask and two loads, no validation in release
+    T& operator[](PoolHandle handle) const
+    {
+        assert(IsValid(handle));
+        return m_chunks[ChunkOf(handle.Index())]->objects[SlotOf(handle.Index())];
+    }
+
+    // Is this handle still the current owner of its object
+    bool IsValid(PoolHandle handle) const;
+
+    // Return an object back to the pool for later reuse.  A stale or repeated Return is
+    // rejected and reported instead of pushing the object onto the free list twice.
+    bool Return(PoolHandle handle);
+
+    // Reset pool: mark every object as available again and invalidate all handles
     void Reset();
+
+    // Call fn(PoolHandle, T&) for every object currently handed out, in slab order
+    template <typename Fn>
+    void ForEachLive(Fn&& fn);
+
+    size_t GetSize() const { return m_chunks.size() * CHUNK_SIZE; }
+    size_t GetAvailableCount() const { return m_available.size(); }
+    size_t GetRejectedReturns() const { return m_rejectedReturns; }
 };
 
-template <typename T>
-ObjectPool<T>::ObjectPool(size_t initialSize)
+template <typename T, size_t CHUNK_SIZE>
+ObjectPool<T, CHUNK_SIZE>::ObjectPool(size_t initialSize)
 {
-    m_pool.reserve(initialSize);
-    m_available.reserve(initialSize);
+    const size_t chunks = (initialSize + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_chunks.reserve(chunks);
+    m_available.reserve(chunks * CHUNK_SIZE);
 
-    for (size_t i = 0; i < initialSize; ++i)
-    {
-        T* object = new T();       // Allocate new T
-        m_pool.push_back(object);
-        m_available.push_back(object);
-    }
+    for (size_t i = 0; i < chunks; ++i)
+        Grow();
 }
 
-template <typename T>
-ObjectPool<T>::~ObjectPool()
+template <typename T, size_t CHUNK_SIZE>
+bool ObjectPool<T, CHUNK_SIZE>::Grow()
 {
-    // Delete all allocated objects
-    for (T* object : m_pool)
-        delete object;
+    const size_t first = m_chunks.size() * CHUNK_SIZE;
+    if (first + CHUNK_SIZE - 1 > PoolHandle::INDEX_MASK)
+        return false;
+
+    // Allocate a whole slab of T at once
+    std::unique_ptr<Chunk> chunk(new Chunk());
+    for (size_t slot = 0; slot < CHUNK_SIZE; ++slot)
+        chunk->generations[slot] = 1;
+    for (size_t word = 0; word < WORDS_PER_CHUNK; ++word)
+        chunk->inUse[word] = 0;
+    m_chunks.push_back(std::move(chunk));
+
+    // Push in reverse so Get() hands out the lowest index first
+    for (size_t i = CHUNK_SIZE; i-- > 0;)
+        m_available.push_back(static_cast<uint32_t>(first + i));
+    return true;
 }
 
-template <typename T>
-T* ObjectPool<T>::Get()
+template <typename T, size_t CHUNK_SIZE>
+PoolHandle ObjectPool<T, CHUNK_SIZE>::Get()
 {
-    if (m_available.empty())
+    if (m_available.empty() && !Grow())
     {
-        // Pool exhausted: allocate additional object
-        T* object = new T();
-        m_pool.push_back(object);
-        return object;
+        std::cerr << "ObjectPool: exhausted at " << GetSize() << " objects" << std::endl;
+        return PoolHandle();
     }
-    else
+
+    // Reuse an available object
+    const uint32_t index = m_available.back();
+    m_available.pop_back();
+
+    Chunk& chunk = *m_chunks[ChunkOf(index)];
+    const size_t slot = SlotOf(index);
+    chunk.inUse[slot >> 6] |= BitOf(slot);
+    return PoolHandle(index, chunk.generations[slot]);
+}
+
+template <typename T, size_t CHUNK_SIZE>
+bool ObjectPool<T, CHUNK_SIZE>::IsValid(PoolHandle handle) const
+{
+    const uint32_t index = handle.Index();
+    return ChunkOf(index) < m_chunks.size()
+        && InUse(index)
+        && m_chunks[ChunkOf(index)]->generations[SlotOf(index)] == handle.Generation();
+}
+
+template <typename T, size_t CHUNK_SIZE>
+T* ObjectPool<T, CHUNK_SIZE>::Resolve(PoolHandle handle) const
+{
+    return IsValid(handle) ? &m_chunks[ChunkOf(handle.Index())]->objects[SlotOf(handle.Index())] : nullptr;
+}
+
+template <typename T, size_t CHUNK_SIZE>
+bool ObjectPool<T, CHUNK_SIZE>::Return(PoolHandle handle)
+{
+    if (!IsValid(handle))
     {
-        // Reuse an available object
-        T* object = m_available.back();
-        m_available.pop_back();
-        return object;
+        ++m_rejectedReturns;
+        std::cerr << "ObjectPool: rejected Return of stale handle (index " << handle.Index()
+                  << ", generation " << handle.Generation() << ")" << std::endl;
+        return false;
     }
+
+    // Invalidate outstanding handles (skipping 0 on wrap) and add it back to available list
+    const uint32_t index = handle.Index();
+    Chunk& chunk = *m_chunks[ChunkOf(index)];
+    const size_t slot = SlotOf(index);
+
+    uint32_t& generation = chunk.generations[slot];
+    generation = (generation + 1) & PoolHandle::GENERATION_MASK;
+    if (generation == 0)
+        generation = 1;
+
+    chunk.inUse[slot >> 6] &= ~BitOf(slot);
+    m_available.push_back(index);
+    return true;
 }
 
-template <typename T>
-void ObjectPool<T>::Return(T* object)
+template <typename T, size_t CHUNK_SIZE>
+void ObjectPool<T, CHUNK_SIZE>::Reset()
 {
-    // Add it back to available list
-    m_available.push_back(object);
+    // Return every live object, then rebuild the free list in Get() order
+    ForEachLive([this](PoolHandle handle, T&) { Return(handle); });
+
+    m_available.clear();
+    for (size_t i = GetSize(); i-- > 0;)
+        m_available.push_back(static_cast<uint32_t>(i));
 }
 
-template <typename T>
-void ObjectPool<T>::Reset()
+template <typename T, size_t CHUNK_SIZE>
+template <typename Fn>
+void ObjectPool<T, CHUNK_SIZE>::ForEachLive(Fn&& fn)
 {
-    // Make all objects available again
-    m_available.clear();
-    for (T* object : m_pool)
-        m_available.push_back(object);
-}
\ No newline at end of file
+    for (size_t c = 0; c < m_chunks.size(); ++c)
+    {
+        Chunk& chunk = *m_chunks[c];
+        for (size_t word = 0; word < WORDS_PER_CHUNK; ++word)
+        {
+            const uint64_t bits = chunk.inUse[word];
+            if (bits == 0)
+                continue;   // Skip 64 free slots at once
+
+            for (size_t bit = 0; bit < 64; ++bit)
+            {
+                if ((bits & (uint64_t(1) << bit)) == 0)
+                    continue;
+
+                const size_t slot = word * 64 + bit;
+                fn(PoolHandle(static_cast<uint32_t>(c * CHUNK_SIZE + slot), chunk.generations[slot]), chunk.objects[slot]);
+            }
+        }
+    }
+}
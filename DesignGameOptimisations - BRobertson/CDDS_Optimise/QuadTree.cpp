@@ -1,100 +1,853 @@
 ﻿#include "QuadTree.h"
-#include "Critter.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
 
-QuadTree::QuadTree(const AABB& region)
-    : m_region(region)           // Copy in the region bounds
-    , m_divided(false)           // No children yet
-    , m_northWest(nullptr)       // Initialise child pointers to nullptr
-    , m_northEast(nullptr)
-    , m_southWest(nullptr)
-    , m_southEast(nullptr)
-{}
+namespace {
+    // Heap order for QueryKNearest: the furthest neighbour sits at the front
+    inline bool NeighbourCloser(const QuadTree::Neighbour& a, const QuadTree::Neighbour& b)
+    {
+        return a.distanceSq < b.distanceSq;
+    }
+}
+
+const uint32_t QuadTree::NONE;  // Bound to a const reference by vector::resize
+
+QuadTree::QuadTree(const AABB& region, uint32_t capacity, uint32_t maxDepth)
+    : m_capacity(capacity > 0 ? capacity : 1)
+    , m_maxDepth(maxDepth)
+    , m_initialRegion(region)
+    , m_threads(1)
+    , m_store(nullptr)
+{
+    AddNode(region, NONE);  // Root
+}
+
+// Append a leaf node and a block of 'capacity' item slots.  Both vectors keep their capacity across Clear, so after
+// the first few frames this never allocates.  The free-group list grows alongside the node array (every group could be
+// released at once), so TryMerge never has to allocate either.
+
+uint32_t QuadTree::AddNode(const AABB& region, uint32_t parent)
+{
+    const uint32_t index = static_cast<uint32_t>(m_nodes.size());
+    const uint32_t firstSlot = static_cast<uint32_t>(m_items.size());
+    m_nodes.push_back(Node{ region, NO_CHILDREN, 0, 0.0f, parent, firstSlot, m_capacity });
+    ResizeItems(firstSlot + m_capacity);
+    if (m_freeGroups.capacity() < m_nodes.capacity() / 4)
+        m_freeGroups.reserve(m_nodes.capacity() / 4);
+    return index;
+}
+
+// A tree filled evenly needs about one leaf per 'capacity' critters.  Critters bunch up and move, so room is kept for
+// twice that many sibling groups, with their item blocks and child bounds.  reserve() is a no-op once the storage is
+// big enough, so calling this every Build costs a few compares.
+
+void QuadTree::Reserve(size_t critters)
+{
+    const size_t groups = 2 * ((critters + m_capacity - 1) / m_capacity) + 1;
+    const size_t nodes = 1 + 4 * groups;
+    m_nodes.reserve(nodes);
+    m_items.reserve(nodes * m_capacity);
+    m_itemNodes.reserve(nodes * m_capacity);
+    m_childBounds.reserve(groups);
+    if (m_itemSlots.size() < critters)
+        m_itemSlots.resize(critters, NONE);
+}
+
+void QuadTree::ResizeItems(size_t slots)
+{
+    m_items.resize(slots);
+    m_itemNodes.resize(slots);
+}
 
-// Destructor
+// Subdivide a node into four equal quadrants.  The children sit next to each other in the node array, so only the
+// first index needs storing; a group released by an earlier merge is reused before the array grows.
 
-QuadTree::~QuadTree()
+void QuadTree::Subdivide(uint32_t node)
 {
-    Clear();  // Recursively delete all children and clear stored points
+    AABB quadrants[4];
+    SplitRegion(m_nodes[node].region.bounds, quadrants);
+
+    uint32_t first;
+    if (!m_freeGroups.empty()) {
+        first = m_freeGroups.back();
+        m_freeGroups.pop_back();
+        for (uint32_t i = 0; i < 4; ++i) {
+            // Keep the reused nodes' item blocks
+            Node& child = m_nodes[first + i];
+            child = Node{ quadrants[i], NO_CHILDREN, 0, 0.0f, node, child.firstSlot, child.slotCount };
+        }
+    }
+    else {
+        first = AddNode(quadrants[0], node);
+        for (uint32_t i = 1; i < 4; ++i)
+            AddNode(quadrants[i], node);
+    }
+
+    m_nodes[node].firstChild = first;  // Mark that we have subdivided (AddNode may have moved m_nodes)
+    UpdateChildBounds(first);
 }
 
-// Subdivide this node into four equal quadrants.  Splits m_region into NW, NE, SW and SE child nodes whenever the capacity threshold is exceeded.
+void QuadTree::UpdateChildBounds(uint32_t firstChild)
+{
+    const uint32_t group = (firstChild - 1) / 4;
+    if (group >= m_childBounds.size())
+        m_childBounds.resize(group + 1);
+
+    ChildBounds& bounds = m_childBounds[group];
+    for (uint32_t i = 0; i < 4; ++i) {
+        const Rectangle& region = m_nodes[firstChild + i].region.bounds;
+        bounds.minX[i] = region.x;
+        bounds.minY[i] = region.y;
+        bounds.maxX[i] = region.x + region.width;
+        bounds.maxY[i] = region.y + region.height;
+    }
+}
 
-void QuadTree::Subdivide()
+void QuadTree::SplitRegion(const Rectangle& bounds, AABB outQuadrants[4])
 {
     // Calculate half‐width and half‐height of this region
-    float x = m_region.bounds.x;
-    float y = m_region.bounds.y;
-    float w = m_region.bounds.width * 0.5f;  // Half the width
-    float h = m_region.bounds.height * 0.5f;  // Half the height
+    float x = bounds.x;
+    float y = bounds.y;
+    float w = bounds.width * 0.5f;  // Half the width
+    float h = bounds.height * 0.5f;  // Half the height
+
+    // Define the four quadrants (order matters: child index = NW + (east ? 1 : 0) + (south ? 2 : 0))
+    outQuadrants[0] = AABB{ { x,     y,     w, h } };  // North‐West
+    outQuadrants[1] = AABB{ { x + w, y,     w, h } };  // North‐East
+    outQuadrants[2] = AABB{ { x,     y + h, w, h } };  // South‐West
+    outQuadrants[3] = AABB{ { x + w, y + h, w, h } };  // South‐East
+}
+
+void QuadTree::PlaceItem(uint32_t node, Item item)
+{
+    if (m_nodes[node].count == m_nodes[node].slotCount)
+        GrowBlock(node);
+
+    const uint32_t slot = m_nodes[node].firstSlot + m_nodes[node].count++;
+    m_items[slot] = item;
+    m_itemNodes[slot] = node;
+
+    if (item.id >= m_itemSlots.size())
+        m_itemSlots.resize(item.id + 1, NONE);
+    m_itemSlots[item.id] = slot;
+}
+
+// Only leaves at max depth fill their block, so this is the slow path for piled-up critters.  The old block is simply
+// abandoned: blocks double, so the waste is at most the size of the buckets themselves, and a released node keeps its
+// bigger block when Subdivide reuses it.
+
+void QuadTree::GrowBlock(uint32_t node)
+{
+    const uint32_t oldFirst = m_nodes[node].firstSlot;
+    const uint32_t count = m_nodes[node].count;
+    const uint32_t newFirst = static_cast<uint32_t>(m_items.size());
+    const uint32_t newCount = m_nodes[node].slotCount * 2;
+
+    ResizeItems(newFirst + newCount);
+    for (uint32_t i = 0; i < count; ++i) {
+        m_items[newFirst + i] = m_items[oldFirst + i];
+        m_itemNodes[newFirst + i] = node;
+        m_itemSlots[m_items[newFirst + i].id] = newFirst + i;
+    }
+
+    m_nodes[node].firstSlot = newFirst;
+    m_nodes[node].slotCount = newCount;
+}
 
-    // Define the four quadrants
-    AABB nw{ { x,     y,     w, h } };           // North‐West
-    AABB ne{ { x + w, y,     w, h } };           // North‐East
-    AABB sw{ { x,     y + h, w, h } };           // South‐West
-    AABB se{ { x + w, y + h, w, h } };           // South‐East
+// The slot table is never cleared, so an entry is only trusted if the slot it names is in use and still holds this
+// critter.  That keeps Clear O(1).
 
-    // Allocate child quadtrees on the heap
-    m_northWest = new QuadTree(nw);
-    m_northEast = new QuadTree(ne);
-    m_southWest = new QuadTree(sw);
-    m_southEast = new QuadTree(se);
+uint32_t QuadTree::FindSlot(CritterView critter) const
+{
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_itemSlots.size() || critter.GetStore() != m_store)
+        return NONE;
+
+    const uint32_t slot = m_itemSlots[index];
+    if (slot >= m_items.size())
+        return NONE;  // Also catches NONE
 
-    m_divided = true;  // Mark that we have subdivided
+    const uint32_t owner = m_itemNodes[slot];
+    if (owner >= m_nodes.size() || m_items[slot].id != index)
+        return NONE;
+
+    const Node& node = m_nodes[owner];
+    if (slot < node.firstSlot || slot >= node.firstSlot + node.count)
+        return NONE;
+    return slot;
 }
 
-bool QuadTree::Insert(Critter* critter, const Vector2& position)
+void QuadTree::RemoveSlot(uint32_t slot)
 {
-    if (!m_region.Contains(position))
-        return false;  // Outside this node’s bounds
+    Node& node = m_nodes[m_itemNodes[slot]];
+    const uint32_t last = node.firstSlot + --node.count;
+    if (slot != last) {
+        m_items[slot] = m_items[last];
+        m_itemSlots[m_items[slot].id] = slot;
+    }
+}
+
+// Incremental rebuild: live critters are moved (only changing node when they cross a boundary), ones that aren't in the
+// tree yet (new or respawned) are inserted and dead ones are removed.  Each critter queues at most one node for merging,
+// so reserving one entry per critter keeps the merge queue from allocating.
+
+void QuadTree::Build(CritterStore& critters)
+{
+    const uint32_t count = static_cast<uint32_t>(critters.Size());
+    Reserve(count);
+    if (m_pendingMerges.capacity() < m_pendingMerges.size() + count)
+        m_pendingMerges.reserve(m_pendingMerges.size() + count);
+    for (uint32_t i = 0; i < count; ++i) {
+        CritterView critter = critters.Get(i);
+        if (!critters.IsAlive(i)) {
+            Remove(critter);
+            continue;
+        }
+
+        const Vector2 position = critters.GetPosition(i);
+        const float radius = critters.GetRadius(i);
+        if (!Update(critter, position, radius))
+            Insert(critter, position, radius);
+    }
+
+    MergeUnderfull();
+}
+
+// Walk down from the root instead of recursing.  A full node passes the critter to the quadrant containing it; points
+// on a dividing line go west/north, the same as trying NW, NE, SW, SE in order.
 
-    if (m_points.size() < CAPACITY) {
-        m_points.push_back(critter);
+bool QuadTree::Insert(CritterView critter, const Vector2& position)
+{
+    return Insert(critter, position, 0.0f);
+}
+
+// Same descent as a point insert; every node passed on the way down widens its loose margin to cover the new circle.
+// The item is recorded by store index, so the tree adopts the critter's store.
+
+bool QuadTree::Insert(CritterView critter, const Vector2& position, float radius)
+{
+    if (!m_nodes[0].region.Contains(position)) {
+        if (!std::isfinite(position.x) || !std::isfinite(position.y))
+            return false;  // Could never be reached by doubling
+        while (!m_nodes[0].region.Contains(position))
+            GrowRoot(position);
+    }
+
+    m_store = critter.GetStore();
+    const Item item{ position.x, position.y, critter.GetIndex(), radius };
+
+    uint32_t node = 0;
+    for (uint32_t depth = 0;; ++depth) {
+        Node& current = m_nodes[node];
+        if (radius > current.maxRadius)
+            current.maxRadius = radius;
+
+        if (current.count < m_capacity) {
+            PlaceItem(node, item);
+            return true;
+        }
+
+        if (current.firstChild == NO_CHILDREN) {
+            if (depth >= m_maxDepth) {
+                PlaceItem(node, item);  // Overflow bucket
+                return true;
+            }
+            Subdivide(node);
+        }
+
+        const Node& parent = m_nodes[node];
+        const float midX = parent.region.bounds.x + parent.region.bounds.width * 0.5f;
+        const float midY = parent.region.bounds.y + parent.region.bounds.height * 0.5f;
+        node = parent.firstChild + (position.x > midX ? 1 : 0) + (position.y > midY ? 2 : 0);
+    }
+}
+
+// Most frames a critter stays inside its node's region, which costs one lookup, one containment test and a refresh of
+// its stored centre.  Only when it leaves is it removed and re-inserted from the root.
+
+bool QuadTree::Update(CritterView critter, const Vector2& newPosition, float radius)
+{
+    const uint32_t slot = FindSlot(critter);
+    if (slot == NONE)
+        return false;
+
+    const uint32_t node = m_itemNodes[slot];
+    if (m_nodes[node].region.Contains(newPosition)) {
+        Item& item = m_items[slot];
+        item.x = newPosition.x;
+        item.y = newPosition.y;
+        item.radius = radius;
+
+        // Ancestors' margins are never smaller than a descendant's, so stop at the first that already covers it
+        for (uint32_t n = node; n != NONE && radius > m_nodes[n].maxRadius; n = m_nodes[n].parent)
+            m_nodes[n].maxRadius = radius;
         return true;
     }
 
-    if (!m_divided)
-        Subdivide();
+    RemoveSlot(slot);
+    m_pendingMerges.push_back(node);
+    return Insert(critter, newPosition, radius);
+}
 
-    // Try inserting into children
-    if (m_northWest->Insert(critter, position)) return true;
-    if (m_northEast->Insert(critter, position)) return true;
-    if (m_southWest->Insert(critter, position)) return true;
-    if (m_southEast->Insert(critter, position)) return true;
+bool QuadTree::Remove(CritterView critter)
+{
+    const uint32_t slot = FindSlot(critter);
+    if (slot == NONE)
+        return false;
 
-    // (Should never happen)
-    return false;
+    m_pendingMerges.push_back(m_itemNodes[slot]);
+    RemoveSlot(slot);
+    return true;
 }
 
-void QuadTree::Query(const AABB& range, std::vector<Critter*>& outResults) const
+// The new root is split like any other node, then swaps places with the quadrant on the far side from 'towards': that
+// quadrant takes over the old root's children, items and exact region, and the root takes the quadrant's empty item
+// block.  Only the old root's direct children and items need their parent link fixed.
+
+void QuadTree::GrowRoot(const Vector2& towards)
 {
-    // If query region doesn't intersect this node, bail out
-    if (!m_region.Intersects(range))
+    const Node oldRoot = m_nodes[0];
+    const Rectangle old = oldRoot.region.bounds;
+    const bool west = towards.x < old.x;
+    const bool north = towards.y < old.y;
+
+    m_nodes[0].region = AABB{ GrownRegion(old, towards) };
+    m_nodes[0].firstChild = NO_CHILDREN;
+    Subdivide(0);
+
+    const uint32_t moved = m_nodes[0].firstChild + (west ? 1 : 0) + (north ? 2 : 0);
+    Node& root = m_nodes[0];
+    Node& child = m_nodes[moved];
+
+    root.count = 0;
+    root.firstSlot = child.firstSlot;
+    root.slotCount = child.slotCount;
+
+    child.region = oldRoot.region;
+    child.firstChild = oldRoot.firstChild;
+    child.count = oldRoot.count;
+    child.maxRadius = oldRoot.maxRadius;
+    child.firstSlot = oldRoot.firstSlot;
+    child.slotCount = oldRoot.slotCount;
+    UpdateChildBounds(root.firstChild);
+
+    if (child.firstChild != NO_CHILDREN) {
+        for (uint32_t i = child.firstChild; i < child.firstChild + 4; ++i)
+            m_nodes[i].parent = moved;
+    }
+    for (uint32_t i = 0; i < child.count; ++i)
+        m_itemNodes[child.firstSlot + i] = moved;
+}
+
+Rectangle QuadTree::GrownRegion(const Rectangle& bounds, const Vector2& towards)
+{
+    const float width = bounds.width > 0.0f ? bounds.width : 1.0f;
+    const float height = bounds.height > 0.0f ? bounds.height : 1.0f;
+    const bool west = towards.x < bounds.x;
+    const bool north = towards.y < bounds.y;
+    return Rectangle{ west ? bounds.x - width : bounds.x, north ? bounds.y - height : bounds.y, width * 2.0f, height * 2.0f };
+}
+
+// A node can absorb its children when all four are leaves and their items fit in its own block.  The merged node's
+// loose margin is recomputed from what it now holds, so merging also tightens queries.
+
+bool QuadTree::TryMerge(uint32_t node)
+{
+    Node& current = m_nodes[node];
+    if (current.firstChild == NO_CHILDREN)
+        return false;
+
+    uint32_t total = current.count;
+    for (uint32_t child = current.firstChild; child < current.firstChild + 4; ++child) {
+        if (m_nodes[child].firstChild != NO_CHILDREN)
+            return false;
+        total += m_nodes[child].count;
+    }
+    if (total > m_capacity)
+        return false;
+
+    const uint32_t first = current.firstChild;
+    for (uint32_t child = first; child < first + 4; ++child) {
+        while (m_nodes[child].count > 0) {
+            const uint32_t slot = m_nodes[child].firstSlot + m_nodes[child].count - 1;
+            const Item item = m_items[slot];
+            RemoveSlot(slot);
+            PlaceItem(node, item);
+        }
+    }
+
+    Node& merged = m_nodes[node];
+    merged.firstChild = NO_CHILDREN;
+    merged.maxRadius = 0.0f;
+    for (uint32_t i = 0; i < merged.count; ++i) {
+        if (m_items[merged.firstSlot + i].radius > merged.maxRadius)
+            merged.maxRadius = m_items[merged.firstSlot + i].radius;
+    }
+
+    m_freeGroups.push_back(first);
+    return true;
+}
+
+// A removal can make either the node itself (if it has children) or its parent mergeable.  After a merge the parent
+// is checked too, so a cluster that emptied out collapses all the way up.  Released groups may be queued more than
+// once or already reused; TryMerge only looks at the current state, so stale entries are harmless.
+
+void QuadTree::MergeUnderfull()
+{
+    while (!m_pendingMerges.empty()) {
+        const uint32_t node = m_pendingMerges.back();
+        m_pendingMerges.pop_back();
+        if (node >= m_nodes.size())
+            continue;
+
+        uint32_t candidate = m_nodes[node].firstChild != NO_CHILDREN ? node : m_nodes[node].parent;
+        while (candidate != NONE && TryMerge(candidate))
+            candidate = m_nodes[candidate].parent;
+    }
+}
+
+void QuadTree::Query(const AABB& range, ArenaVector<CritterView>& outResults) const
+{
+    Query(range, [&outResults](CritterView critter) {
+        outResults.push_back(critter);
+        return true;
+    });
+}
+
+void QuadTree::QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const
+{
+    QueryCircle(centre, radius, [&outResults](CritterView critter) {
+        outResults.push_back(critter);
+        return true;
+    });
+}
+
+// Sort the heap into nearest-first order once the search is done.
+
+uint32_t QuadTree::QueryKNearest(const Vector2& point, uint32_t k, Neighbour* outNearest) const
+{
+    uint32_t found = 0;
+    if (k == 0)
+        return 0;
+
+    KNearestNode(0, point, k, outNearest, found);
+    std::sort_heap(outNearest, outNearest + found, NeighbourCloser);
+    return found;
+}
+
+// outNearest[0, found) is a max-heap on distance, so its front is the k-th best so far.  A node is skipped once the heap
+// is full and the node's region is further away than that; children are visited nearest first so the bound tightens early.
+
+void QuadTree::KNearestNode(uint32_t node, const Vector2& point, uint32_t k, Neighbour* outNearest, uint32_t& found) const
+{
+    const Node& current = m_nodes[node];
+
+    const Item* items = &m_items[current.firstSlot];
+    for (uint32_t i = 0; i < current.count; ++i) {
+        const float dx = items[i].x - point.x;
+        const float dy = items[i].y - point.y;
+        const float distanceSq = dx * dx + dy * dy;
+
+        if (found < k) {
+            outNearest[found++] = Neighbour{ ViewOf(items[i]), distanceSq };
+            std::push_heap(outNearest, outNearest + found, NeighbourCloser);
+        }
+        else if (distanceSq < outNearest[0].distanceSq) {
+            std::pop_heap(outNearest, outNearest + found, NeighbourCloser);
+            outNearest[found - 1] = Neighbour{ ViewOf(items[i]), distanceSq };
+            std::push_heap(outNearest, outNearest + found, NeighbourCloser);
+        }
+    }
+
+    if (current.firstChild == NO_CHILDREN)
         return;
 
-    // Check points at this node
-    for (auto* critter : m_points) {
-        if (range.Contains(critter->GetPosition()))
-            outResults.push_back(critter);
+    // Order the four children by distance (insertion sort)
+    uint32_t order[4];
+    float distances[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        const float distanceSq = DistanceSqToRect(point, m_nodes[current.firstChild + i].region.bounds);
+        uint32_t j = i;
+        for (; j > 0 && distances[j - 1] > distanceSq; --j) {
+            distances[j] = distances[j - 1];
+            order[j] = order[j - 1];
+        }
+        distances[j] = distanceSq;
+        order[j] = current.firstChild + i;
     }
 
-    // If subdivided, query children
-    if (m_divided) {
-        m_northWest->Query(range, outResults);
-        m_northEast->Query(range, outResults);
-        m_southWest->Query(range, outResults);
-        m_southEast->Query(range, outResults);
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (found == k && distances[i] >= outNearest[0].distanceSq)
+            return;  // The rest are further still
+        KNearestNode(order[i], point, k, outNearest, found);
     }
 }
 
-void QuadTree::Clear()
+// Nearest-hit casts: every hit pulls the walk's distance limit in to itself, so anything reported after it is at least
+// as close and nodes the ray enters beyond it are skipped.
+
+bool QuadTree::RayCast(const Vector2& origin, const Vector2& direction, float maxDistance, RayHit& outHit) const
+{
+    Cast cast;
+    if (!MakeCast(origin, direction, 0.0f, cast))
+        return false;
+
+    bool hit = false;
+    auto closest = [&](CritterView critter, float distance) {
+        outHit = RayHit{ critter, distance };
+        hit = true;
+        maxDistance = distance;
+        return true;
+    };
+    CastNode(0, cast, maxDistance, closest);
+    return hit;
+}
+
+bool QuadTree::SweepCircle(const Vector2& from, const Vector2& to, float radius, RayHit& outHit) const
+{
+    float length;
+    const Cast cast = MakeSweep(from, to, radius, length);
+
+    bool hit = false;
+    auto closest = [&](CritterView critter, float distance) {
+        outHit = RayHit{ critter, distance };
+        hit = true;
+        length = distance;
+        return true;
+    };
+    CastNode(0, cast, length, closest);
+    return hit;
+}
+
+void QuadTree::QueryPairs(PairCallback onPair) const
+{
+    // Wrapped so overload resolution picks the template rather than this function again
+    QueryPairs([&onPair](CritterView a, CritterView b) {
+        onPair(a, b);
+    });
+}
+
+void QuadTree::SetThreadCount(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    m_threads = threads > 0 ? threads : 1;
+}
+
+// The levels above TASK_DEPTH are built serially into m_top, which leaves a task for every subtree that still needs
+// splitting at that depth.  Each task builds into its own fragment, so workers share nothing but the atomic task
+// counter.  The workers come from the tree's own pool and stay parked between builds.  m_top becomes the start of the
+// node array and the fragments are appended in task order, so the layout is the same however the tasks were scheduled.
+
+void QuadTree::Build(BulkItem* items, size_t count)
+{
+    Clear();
+
+    BulkItem* end = std::partition(items, items + count, [](const BulkItem& item) {
+        return std::isfinite(item.position.x) && std::isfinite(item.position.y);
+    });
+    count = static_cast<size_t>(end - items);
+    if (count > 0)
+        m_store = items[0].critter.GetStore();
+
+    // Grow the root (still empty) until it covers both corners of the items' bounding box
+    Rectangle region = m_initialRegion.bounds;
+    if (count > 0) {
+        Vector2 low = items[0].position;
+        Vector2 high = items[0].position;
+        for (size_t i = 1; i < count; ++i) {
+            low.x = std::min(low.x, items[i].position.x);
+            low.y = std::min(low.y, items[i].position.y);
+            high.x = std::max(high.x, items[i].position.x);
+            high.y = std::max(high.y, items[i].position.y);
+        }
+        while (!AABB{ region }.Contains(low))
+            region = GrownRegion(region, low);
+        while (!AABB{ region }.Contains(high))
+            region = GrownRegion(region, high);
+    }
+
+    m_top.nodes.clear();
+    m_top.items.clear();
+    m_tasks.clear();
+    AddFragmentNode(m_top, AABB{ region }, NONE, m_capacity);
+    BuildSubtree(m_top, 0, items, count, 0, &m_tasks);
+
+    if (m_fragments.size() < m_tasks.size())
+        m_fragments.resize(m_tasks.size());
+
+    auto runTask = [this](size_t t) {
+        const BulkTask& task = m_tasks[t];
+        Fragment& fragment = m_fragments[t];
+        fragment.nodes.clear();
+        fragment.items.clear();
+        AddFragmentNode(fragment, m_top.nodes[task.node].region, NONE, m_capacity);
+        BuildSubtree(fragment, 0, task.items, task.count, task.depth, nullptr);
+    };
+
+    const size_t tasks = m_tasks.size();
+    const unsigned threads = count >= PARALLEL_MIN ? static_cast<unsigned>(std::min<size_t>(m_threads, tasks)) : 1u;
+    if (threads <= 1) {
+        for (size_t t = 0; t < tasks; ++t)
+            runTask(t);
+    }
+    else {
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t t = next++; t < tasks; t = next++)
+                runTask(t);
+        };
+
+        auto job = [&worker](unsigned) { worker(); };
+        m_workers.Run(threads, job);
+    }
+
+    // Top levels go in as they are, then every task's subtree
+    const uint32_t topCount = static_cast<uint32_t>(m_top.nodes.size());
+    m_nodes.assign(m_top.nodes.begin(), m_top.nodes.end());
+    m_items.assign(m_top.items.begin(), m_top.items.end());
+    m_itemNodes.resize(m_items.size());
+    for (uint32_t node = 0; node < topCount; ++node) {
+        const Node& current = m_nodes[node];
+        for (uint32_t slot = current.firstSlot; slot < current.firstSlot + current.count; ++slot) {
+            const uint32_t index = m_items[slot].id;
+            if (index >= m_itemSlots.size())
+                m_itemSlots.resize(index + 1, NONE);
+            m_itemSlots[index] = slot;
+            m_itemNodes[slot] = node;
+        }
+    }
+    for (size_t t = 0; t < tasks; ++t)
+        SpliceFragment(m_fragments[t], m_tasks[t].node);
+    for (uint32_t first = 1; first < m_nodes.size(); first += 4)
+        UpdateChildBounds(first);
+
+    // Task roots only learnt their radius from their fragment, so refresh the top levels' margins bottom-up (a child
+    // always comes after its parent)
+    for (uint32_t node = topCount - 1; node > 0; --node) {
+        Node& parent = m_nodes[m_nodes[node].parent];
+        parent.maxRadius = std::max(parent.maxRadius, m_nodes[node].maxRadius);
+    }
+}
+
+// Builds straight into the node and item arrays.  The records are already in the leaves' Item layout, so a leaf is a
+// plain copy.  The root is still empty after Clear, so it can simply be given the grown region instead of going
+// through GrowRoot.
+
+void QuadTree::BulkLoad(CritterStore& critters)
+{
+    Clear();
+    m_store = &critters;
+
+    const uint32_t total = static_cast<uint32_t>(critters.Size());
+    const float* x = critters.X();
+    const float* y = critters.Y();
+    const float* radius = critters.Radius();
+
+    m_loadRecords.clear();
+    for (uint32_t i = 0; i < total; ++i) {
+        if (critters.IsAlive(i) && std::isfinite(x[i]) && std::isfinite(y[i]))
+            m_loadRecords.push_back(Item{ x[i], y[i], i, radius[i] });
+    }
+    const uint32_t count = static_cast<uint32_t>(m_loadRecords.size());
+    if (count == 0)
+        return;
+
+    Rectangle region = m_nodes[0].region.bounds;
+    Vector2 low{ m_loadRecords[0].x, m_loadRecords[0].y };
+    Vector2 high = low;
+    for (const Item& record : m_loadRecords) {
+        low.x = std::min(low.x, record.x);
+        low.y = std::min(low.y, record.y);
+        high.x = std::max(high.x, record.x);
+        high.y = std::max(high.y, record.y);
+    }
+    while (!AABB{ region }.Contains(low))
+        region = GrownRegion(region, low);
+    while (!AABB{ region }.Contains(high))
+        region = GrownRegion(region, high);
+    m_nodes[0].region = AABB{ region };
+
+    m_loadScratch.resize(count);
+    if (m_itemSlots.size() < total)
+        m_itemSlots.resize(total, NONE);
+    LoadNode(0, m_loadRecords.data(), m_loadScratch.data(), count, 0);
+}
+
+// Same split rule as Insert and BuildSubtree.  The first pass counts each quadrant, the second scatters the records into
+// their quadrant's run of 'scratch', keeping their order, and the children then partition those runs back into
+// 'records'.
+
+float QuadTree::LoadNode(uint32_t node, Item* records, Item* scratch, uint32_t count, uint32_t depth)
 {
-    m_points.clear();
-    if (m_divided) {
-        delete m_northWest;
-        delete m_northEast;
-        delete m_southWest;
-        delete m_southEast;
-        m_northWest = m_northEast = m_southWest = m_southEast = nullptr;
-        m_divided = false;
+    if (count <= m_capacity || depth >= m_maxDepth) {
+        if (count > m_nodes[node].slotCount) {
+            // Overflow bucket: a bigger block at the end
+            m_nodes[node].firstSlot = static_cast<uint32_t>(m_items.size());
+            m_nodes[node].slotCount = count;
+            ResizeItems(m_items.size() + count);
+        }
+
+        Node& leaf = m_nodes[node];
+        float maxRadius = 0.0f;
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t slot = leaf.firstSlot + i;
+            m_items[slot] = records[i];
+            m_itemNodes[slot] = node;
+            m_itemSlots[records[i].id] = slot;
+            maxRadius = std::max(maxRadius, records[i].radius);
+        }
+        leaf.count = count;
+        leaf.maxRadius = maxRadius;
+        return maxRadius;
     }
-}
\ No newline at end of file
+
+    const Rectangle bounds = m_nodes[node].region.bounds;
+    const float midX = bounds.x + bounds.width * 0.5f;
+    const float midY = bounds.y + bounds.height * 0.5f;
+
+    uint32_t starts[5] = { 0, 0, 0, 0, 0 };
+    for (uint32_t i = 0; i < count; ++i)
+        ++starts[1 + (records[i].x > midX ? 1 : 0) + (records[i].y > midY ? 2 : 0)];
+    for (uint32_t q = 1; q < 5; ++q)
+        starts[q] += starts[q - 1];
+
+    uint32_t next[4] = { starts[0], starts[1], starts[2], starts[3] };
+    for (uint32_t i = 0; i < count; ++i)
+        scratch[next[(records[i].x > midX ? 1 : 0) + (records[i].y > midY ? 2 : 0)]++] = records[i];
+
+    Subdivide(node);
+    const uint32_t first = m_nodes[node].firstChild;
+
+    float maxRadius = 0.0f;
+    for (uint32_t q = 0; q < 4; ++q) {
+        const float childRadius = LoadNode(first + q, scratch + starts[q], records + starts[q], starts[q + 1] - starts[q],
+                                           depth + 1);
+        maxRadius = std::max(maxRadius, childRadius);
+    }
+    m_nodes[node].maxRadius = maxRadius;
+    return maxRadius;
+}
+
+uint32_t QuadTree::AddFragmentNode(Fragment& fragment, const AABB& region, uint32_t parent, uint32_t slots)
+{
+    const uint32_t index = static_cast<uint32_t>(fragment.nodes.size());
+    const uint32_t firstSlot = static_cast<uint32_t>(fragment.items.size());
+    fragment.nodes.push_back(Node{ region, NO_CHILDREN, 0, 0.0f, parent, firstSlot, slots });
+    fragment.items.resize(firstSlot + slots);
+    return index;
+}
+
+// Same rule as Insert: a range that fits (or is at max depth) becomes a leaf, otherwise it is split on the midlines,
+// points on a line going west/north.  The partition is two std::partition calls, north/south and then west/east.
+
+float QuadTree::BuildSubtree(Fragment& fragment, uint32_t node, BulkItem* items, size_t count, uint32_t depth,
+                             std::vector<BulkTask>* tasks) const
+{
+    if (count <= m_capacity || depth >= m_maxDepth) {
+        if (count > fragment.nodes[node].slotCount) {
+            // Overflow bucket: a bigger block at the end
+            fragment.nodes[node].firstSlot = static_cast<uint32_t>(fragment.items.size());
+            fragment.nodes[node].slotCount = static_cast<uint32_t>(count);
+            fragment.items.resize(fragment.items.size() + count);
+        }
+
+        Node& leaf = fragment.nodes[node];
+        float maxRadius = 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            const BulkItem& item = items[i];
+            fragment.items[leaf.firstSlot + i] = Item{ item.position.x, item.position.y, item.critter.GetIndex(), item.radius };
+            maxRadius = std::max(maxRadius, items[i].radius);
+        }
+        leaf.count = static_cast<uint32_t>(count);
+        leaf.maxRadius = maxRadius;
+        return maxRadius;
+    }
+
+    if (tasks && depth == TASK_DEPTH) {
+        tasks->push_back(BulkTask{ node, items, count, depth });
+        return 0.0f;
+    }
+
+    const Rectangle bounds = fragment.nodes[node].region.bounds;
+    const float midX = bounds.x + bounds.width * 0.5f;
+    const float midY = bounds.y + bounds.height * 0.5f;
+
+    BulkItem* end = items + count;
+    BulkItem* south = std::partition(items, end, [midY](const BulkItem& item) { return !(item.position.y > midY); });
+    BulkItem* northEast = std::partition(items, south, [midX](const BulkItem& item) { return !(item.position.x > midX); });
+    BulkItem* southEast = std::partition(south, end, [midX](const BulkItem& item) { return !(item.position.x > midX); });
+    BulkItem* const ranges[5] = { items, northEast, south, southEast, end };
+
+    AABB quadrants[4];
+    SplitRegion(bounds, quadrants);
+    const uint32_t first = static_cast<uint32_t>(fragment.nodes.size());
+    for (uint32_t i = 0; i < 4; ++i)
+        AddFragmentNode(fragment, quadrants[i], node, m_capacity);
+    fragment.nodes[node].firstChild = first;
+
+    float maxRadius = 0.0f;
+    for (uint32_t i = 0; i < 4; ++i) {
+        const size_t childCount = static_cast<size_t>(ranges[i + 1] - ranges[i]);
+        maxRadius = std::max(maxRadius, BuildSubtree(fragment, first + i, ranges[i], childCount, depth + 1, tasks));
+    }
+    fragment.nodes[node].maxRadius = maxRadius;
+    return maxRadius;
+}
+
+// Fragment node 0 maps to 'target' and node i > 0 to the end of the node array; slots are offset by the item array's
+// old size.  NO_CHILDREN is 0 in both, since a fragment's root is never a child either.
+
+void QuadTree::SpliceFragment(const Fragment& fragment, uint32_t target)
+{
+    const uint32_t nodeOffset = static_cast<uint32_t>(m_nodes.size()) - 1;
+    const uint32_t slotOffset = static_cast<uint32_t>(m_items.size());
+    auto mapNode = [target, nodeOffset](uint32_t local) { return local == 0 ? target : local + nodeOffset; };
+
+    m_items.insert(m_items.end(), fragment.items.begin(), fragment.items.end());
+    m_itemNodes.resize(m_items.size());
+    for (uint32_t local = 0; local < fragment.nodes.size(); ++local) {
+        Node node = fragment.nodes[local];
+        const uint32_t index = mapNode(local);
+        if (node.firstChild != NO_CHILDREN)
+            node.firstChild = mapNode(node.firstChild);
+        node.firstSlot += slotOffset;
+
+        if (local == 0) {
+            node.region = m_nodes[target].region;
+            node.parent = m_nodes[target].parent;
+            m_nodes[target] = node;
+        }
+        else {
+            node.parent = mapNode(node.parent);
+            m_nodes.push_back(node);
+        }
+
+        for (uint32_t slot = node.firstSlot; slot < node.firstSlot + node.count; ++slot) {
+            m_itemNodes[slot] = index;
+
+            const uint32_t critter = m_items[slot].id;
+            if (critter >= m_itemSlots.size())
+                m_itemSlots.resize(critter + 1, NONE);
+            m_itemSlots[critter] = slot;
+        }
+    }
+}
+
+void QuadTree::Clear()
+{
+    // Drop every node and item block but the root's; both types are trivially destructible so this is O(1)
+    m_nodes.resize(1);
+    m_childBounds.clear();
+    m_nodes[0].region = m_initialRegion;
+    ResizeItems(m_capacity);
+    m_freeGroups.clear();
+    m_pendingMerges.clear();
+    m_nodes[0].firstChild = NO_CHILDREN;
+    m_nodes[0].count = 0;
+    m_nodes[0].maxRadius = 0.0f;
+    m_nodes[0].firstSlot = 0;
+    m_nodes[0].slotCount = m_capacity;
+}
@@ -1,52 +1,870 @@
 ﻿#pragma once
 
 #include "raylib.h"
+#include "CritterStore.h"
+#include "FrameArena.h"
+#include "SpatialIndex.h"
+#include "WorkerPool.h"
+#include <cmath>
+#include <cstdint>
+#include <utility>
 #include <vector>
 
-// Forward‐declare Critter so we can store pointers to them
-class Critter;
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QUADTREE_SSE2 1
+#include <emmintrin.h>
+#endif
 
-// Axis‐aligned rectangle for region queries.
+//Quadtree for spatial partitioning of Critters.
+//
+//Flat layout: every node lives in one contiguous array and finds its children through the index of
+//the first of four consecutive siblings.  Each node owns a block of slots in one shared item array
+//(slots [firstSlot, firstSlot + count)), so there are no child pointers and no per-node vectors.
+//Both arrays keep their capacity, so Clear is O(1).
+//
+//Depth limit: a node holds up to 'capacity' critters before passing new ones down to its children,
+//and nodes at 'maxDepth' never split.  A full leaf at the limit turns its block into an overflow
+//bucket instead, moving it to the end of the item array at twice the size.  Many critters on one
+//point (e.g. a burst of respawns) therefore cost one long leaf, not an unbounded chain of splits.
+//
+//Loose mode: critters can be inserted as circles.  A critter is still placed by its centre, but
+//every node remembers the largest radius stored anywhere below it and QueryCircle treats the node
+//as its region grown by that margin.  Circles that straddle a split line are therefore still found,
+//without storing anything twice.  Critters inserted as plain points have radius 0.
+//
+//Incremental maintenance: the tree remembers which slot each critter (by store index) sits in, so
+//Update only moves a critter when it leaves its node's region and Remove is O(1).  Removals queue
+//their node for a lazy merge; MergeUnderfull folds sibling leaves back into their parent once they
+//fit, and freed sibling groups are reused by the next Subdivide.  One tree indexes one CritterStore.
+//
+//Growing root: a critter inserted outside the root's region doubles the root towards it (the old
+//root becomes one quadrant of the new one) until it fits, so entities can roam past the initial
+//world without a rebuild.  Existing nodes and items keep their places.  Clear shrinks the root back.
+//
+//Bulk build: Build(items, count) replaces the tree in one top-down pass.  Each level partitions its
+//range of the array into quadrants in place, and subtrees below TASK_DEPTH are built as separate
+//fragments (in parallel for big builds, on worker threads the tree keeps between builds) and
+//spliced in task order.  The node layout therefore only depends on the items, never on the thread
+//count.  BulkLoad is the single-threaded version for a whole CritterStore: it packs positions into
+//small records and splits each node's range with a counting pass (count per quadrant, then
+//scatter), ping-ponging between two buffers.
+//
+//SIMD traversal: the regions of each group of four siblings are also kept as structure-of-arrays
+//(4 x minX, 4 x minY, 4 x maxX, 4 x maxY), so Query and QueryCircle test all four children with one
+//SSE2 compare per edge and only descend into the lanes that pass.  Items are tested against the
+//query four at a time the same way.  Both fall back to scalar loops without SSE2 and give the same
+//results either way.
+//
+//Inline leaf records: an item is a 16-byte {x, y, id, radius} record holding the centre as of the
+//last Insert/Update and the critter's 32-bit store index.  Queries, pair tests and casts therefore
+//read only the tree's own arrays and never go through the store; a CritterView is only made for
+//the critters handed to a visitor.  Which node owns each slot is kept in a separate array, since
+//only Update and Remove need it.
+//
+//Implements ISpatialIndex; Build keeps the tree in step with a store through Update/Insert/Remove.
 
-struct AABB {
-    Rectangle bounds;
-    // Check if a point lies within this box
-    bool Contains(const Vector2& point) const {
-        return CheckCollisionPointRec(point, bounds);
-    }
-    // Check if two boxes intersect
-    bool Intersects(const AABB& other) const {
-        return CheckCollisionRecs(bounds, other.bounds);
-    }
-};
+class QuadTree : public ISpatialIndex {
+public:
+    static const uint32_t DEFAULT_CAPACITY = 4;    // Critters per node before new ones go to its children
+    static const uint32_t DEFAULT_MAX_DEPTH = 16;  // Deepest level that may be created (the root is level 0)
+
+    // One QueryKNearest result
+    struct Neighbour {
+        CritterView critter;
+        float       distanceSq;   // Squared distance from the query point to the critter's centre
+    };
 
-//Quadtree node for spatial partitioning of Critters.
+    // One entry for the bulk Build
+    struct BulkItem {
+        CritterView critter;
+        Vector2     position;
+        float       radius;
+    };
+
+    // One RayCast / SweepCircle result
+    struct RayHit {
+        CritterView critter;
+        float       distance;     // Distance along the ray (or sweep) to first contact, 0 if it starts overlapping
+    };
 
-class QuadTree {
 private:
-    static const int CAPACITY = 4;   // Max critters before subdividing
-    AABB        m_region;            // This node’s region in world‐space
-    std::vector<Critter*> m_points;  // Critters contained directly here
+    static const uint32_t NO_CHILDREN = 0;  // Node 0 is the root, so it is never anyone's child
+    static const uint32_t NONE = 0xFFFFFFFFu;
+    static const size_t   PARALLEL_MIN = 32768;  // Smaller bulk builds run every task on the calling thread
+    static const uint32_t TASK_DEPTH = 3;        // Bulk build depth whose subtrees become tasks (up to 64)
+
+    struct Node {
+        AABB     region;       // This node’s region in world‐space
+        uint32_t firstChild;   // Index of the NW child (NE, SW, SE follow), or NO_CHILDREN for a leaf
+        uint32_t count;        // Critters stored in this node's item block
+        float    maxRadius;    // Largest item radius in this node or any descendant (loose margin)
+        uint32_t parent;       // NONE for the root
+        uint32_t firstSlot;    // Start of this node's item block in m_items
+        uint32_t slotCount;    // Size of the block: the capacity, or more for an overflow bucket at max depth
+    };
+
+    struct Item {
+        float    x, y;     // Centre as of the last Insert/Update
+        uint32_t id;       // Store index of the critter
+        float    radius;   // Radius given at insertion, 0 for points
+    };
+    static_assert(sizeof(Item) == 16, "SSE2 item batches load one Item per register");
+
+    // A subtree built on its own for the bulk Build, with indices local to it (node 0 is its root).  Item owners are
+    // only filled in when it is spliced into the tree.
+    struct Fragment {
+        std::vector<Node> nodes;
+        std::vector<Item> items;
+    };
+
+    // A subtree the bulk Build left for a task: node 'node' of the top fragment, holding items[0, count)
+    struct BulkTask {
+        uint32_t  node;
+        BulkItem* items;
+        size_t    count;
+        uint32_t  depth;
+    };
+
+    // Regions of one sibling group as structure-of-arrays, one lane per child (NW, NE, SW, SE)
+    struct ChildBounds {
+        float minX[4];
+        float minY[4];
+        float maxX[4];
+        float maxY[4];
+    };
+
+    uint32_t   m_capacity;
+    uint32_t   m_maxDepth;
+    AABB       m_initialRegion;   // Root region to go back to on Clear
+    unsigned   m_threads;         // Worker threads for the bulk Build
+    WorkerPool m_workers;         // Their threads, started by the first parallel Build and reused after
+
+    Fragment              m_top;         // Bulk build levels above TASK_DEPTH
+    std::vector<Fragment> m_fragments;   // One per task; kept so rebuilds reuse their storage
+    std::vector<BulkTask> m_tasks;
+
+    std::vector<Item> m_loadRecords;   // BulkLoad input, and the scratch buffer its counting passes alternate with
+    std::vector<Item> m_loadScratch;
+
+    CritterStore* m_store;   // Store the critters' ids index into (set by the first Insert or build)
+
+    std::vector<Node>     m_nodes;       // m_nodes[0] is the root
+    std::vector<Item>     m_items;       // Every node's item block; blocks outgrown by an overflow bucket are left unused until Clear
+    std::vector<uint32_t> m_itemNodes;   // Slot -> node whose block holds it, parallel to m_items
+
+    std::vector<ChildBounds> m_childBounds;  // Per sibling group; groups start at 1 + 4k, so group (firstChild - 1) / 4
+
+    std::vector<uint32_t> m_itemSlots;       // Critter index -> slot in m_items (stale entries are detected, not cleared)
+    std::vector<uint32_t> m_freeGroups;      // First index of each released group of four siblings
+    std::vector<uint32_t> m_pendingMerges;   // Nodes that lost items since the last MergeUnderfull
+
+    // Split a node into four children, reusing a released sibling group if there is one
+    void Subdivide(uint32_t node);
+
+    // Refresh the SoA copy of a sibling group's regions
+    void UpdateChildBounds(uint32_t firstChild);
+
+    // Bit i set if child i's region overlaps 'range' (the strict test of AABB::Intersects)
+    uint32_t ChildrenOverlapping(uint32_t firstChild, const Rectangle& range) const;
+
+    // Bit i set if child i's loose bounds (region grown by its max radius) overlap a circle
+    uint32_t ChildrenNearCircle(uint32_t firstChild, const Vector2& centre, float radius) const;
+
+    // Append an empty leaf and its item block
+    uint32_t AddNode(const AABB& region, uint32_t parent);
+
+    // Resize the item array and its owner array together
+    void ResizeItems(size_t slots);
+
+    // View of the critter an item stands for
+    CritterView ViewOf(const Item& item) const { return CritterView(m_store, item.id); }
+
+#if QUADTREE_SSE2
+    // Transpose four consecutive items into lanes of x, y and radius
+    static void LoadItems(const Item* items, __m128& outX, __m128& outY, __m128& outRadius);
+#endif
+
+    // Store an item in a node's block (growing it if it is a full overflow bucket) and record where it went
+    void PlaceItem(uint32_t node, Item item);
+
+    // Move a node's items to a new block of twice the size at the end of m_items
+    void GrowBlock(uint32_t node);
+
+    // Slot holding a critter, or NONE if it isn't in the tree
+    uint32_t FindSlot(CritterView critter) const;
+
+    // Take the item out of a slot, filling the hole with the node's last item
+    void RemoveSlot(uint32_t slot);
+
+    // Double the root's region towards a point outside it, moving the old root down to one of the new quadrants
+    void GrowRoot(const Vector2& towards);
+
+    // A region doubled towards a point (the old region becomes one quadrant of it)
+    static Rectangle GrownRegion(const Rectangle& bounds, const Vector2& towards);
+
+    // The four quadrants of a region, NW, NE, SW, SE
+    static void SplitRegion(const Rectangle& bounds, AABB outQuadrants[4]);
+
+    // Append a node with an item block of 'slots' slots to a fragment
+    static uint32_t AddFragmentNode(Fragment& fragment, const AABB& region, uint32_t parent, uint32_t slots);
+
+    // Bulk build items[0, count) into fragment node 'node' (which must exist); returns its largest radius.  With
+    // 'tasks', a subtree at TASK_DEPTH that needs splitting is queued there instead and reports 0.
+    float BuildSubtree(Fragment& fragment, uint32_t node, BulkItem* items, size_t count, uint32_t depth,
+                       std::vector<BulkTask>* tasks) const;
+
+    // BulkLoad one node from records[0, count); children are scattered into 'scratch' and read from there, swapping
+    // the two buffers at each level.  Returns the subtree's largest radius.
+    float LoadNode(uint32_t node, Item* records, Item* scratch, uint32_t count, uint32_t depth);
+
+    // Append a task's fragment to the tree with its root replacing node 'target', and record its item slots
+    void SpliceFragment(const Fragment& fragment, uint32_t target);
+
+    // Fold a node's four leaf children into it if everything fits; returns true if merged
+    bool TryMerge(uint32_t node);
+
+    // Visitor query helpers; return false once the visitor has asked to stop
+    template <typename Visitor>
+    bool QueryNode(uint32_t node, const AABB& range, Visitor& visitor) const;
+    template <typename Visitor>
+    bool QueryCircleNode(uint32_t node, const Vector2& centre, float radius, Visitor& visitor) const;
+
+    template <typename Visitor>
+    bool QueryRadiusNode(uint32_t node, const Vector2& point, float radiusSq, Visitor& visitor) const;
 
-    bool        m_divided;           // Have we subdivided yet
-    QuadTree* m_northWest;
-    QuadTree* m_northEast;
-    QuadTree* m_southWest;
-    QuadTree* m_southEast;
+    // Branch-and-bound step of QueryKNearest; 'found' is the current size of the max-heap in outNearest
+    void KNearestNode(uint32_t node, const Vector2& point, uint32_t k, Neighbour* outNearest, uint32_t& found) const;
 
-    // Subdivide this node into four children
-    void Subdivide();
+    // A ray with a unit direction, hitting circles grown by 'inflate' (the swept radius, 0 for a plain ray)
+    struct Cast {
+        Vector2 origin;
+        Vector2 direction;
+        float   inflate;
+    };
+
+    // Ray walk shared by RayCast and SweepCircle.  Children are visited in order of where the ray enters them and
+    // skipped once that is beyond maxDistance, which the visitor may shrink to prune the rest of the walk.
+    template <typename Visitor>
+    bool CastNode(uint32_t node, const Cast& cast, float& maxDistance, Visitor& visitor) const;
+
+    // Distance along the ray at which it enters a rectangle grown by 'margin'; false if it misses within maxDistance
+    static bool RayEntersRect(const Cast& cast, const Rectangle& rect, float margin, float maxDistance, float& outEnter);
+
+    // Distance along the ray to first contact with a circle; false if it misses within maxDistance
+    static bool RayHitsCircle(const Cast& cast, const Vector2& centre, float radius, float maxDistance, float& outDistance);
+
+    // Normalise a ray, or return false for a zero direction
+    static bool MakeCast(const Vector2& origin, const Vector2& direction, float inflate, Cast& outCast);
+
+    // Ray for a circle moving from 'from' to 'to', and the distance it travels
+    static Cast MakeSweep(const Vector2& from, const Vector2& to, float radius, float& outLength);
+
+    // Squared distance from a point to the closest point of a rectangle (0 inside)
+    static float DistanceSqToRect(const Vector2& point, const Rectangle& rect);
+
+    // Does a circle overlap a rectangle grown by 'margin' on every side
+    static bool CircleOverlapsRect(const Vector2& centre, float radius, const Rectangle& rect, float margin);
+
+    // Do two nodes' loose bounds (region grown by the subtree's max radius) overlap
+    bool LooseOverlap(uint32_t a, uint32_t b) const;
+
+    // QueryPairs helpers: pairs inside one subtree, between one item and a subtree, and between two disjoint subtrees
+    template <typename Callback>
+    void PairsWithin(uint32_t node, Callback& onPair) const;
+    template <typename Callback>
+    void PairsItemSubtree(const Item& item, uint32_t node, Callback& onPair) const;
+    template <typename Callback>
+    void PairsAcross(uint32_t a, uint32_t b, Callback& onPair) const;
+
+    // Exact circle test, reporting the pair lower index first
+    template <typename Callback>
+    void TestPair(const Item& a, const Item& b, Callback& onPair) const;
 
 public:
-    QuadTree(const AABB& region);
-    ~QuadTree();
+    QuadTree(const AABB& region, uint32_t capacity = DEFAULT_CAPACITY, uint32_t maxDepth = DEFAULT_MAX_DEPTH);
+
+    // Move, insert or remove every critter in the store to match its current state, then merge
+    void Build(CritterStore& critters) override;
+
+    // Size node and item storage for about 'critters' critters, so the node arrays stop growing after warm-up.
+    // Build(store) calls this with the store's size; call it before a round of Inserts to avoid regrowth.
+    void Reserve(size_t critters);
+
+    // Replace the whole tree with 'items' in one top-down pass (reordering the array), growing the root to cover
+    // them.  Leaves hold up to the capacity (more only at max depth) and inner nodes start empty.  Builds of at least
+    // PARALLEL_MIN items split the subtrees below TASK_DEPTH across GetThreadCount() threads; the result is the same
+    // for any thread count.  Items with a non-finite position are dropped.
+    void Build(BulkItem* items, size_t count);
+
+    // Replace the whole tree with every live critter in the store, read straight from its position arrays.  Same tree
+    // shape as the bulk Build, built top-down with one counting pass per node; much faster than Clear + Insert.
+    void BulkLoad(CritterStore& critters);
+
+    // Insert a critter as a point, growing the root if it lies outside; false only for a non-finite position
+    bool Insert(CritterView critter, const Vector2& position);
+
+    // Insert a critter as a circle (loose mode), placed by its centre.  Grows the root like the point version.
+    bool Insert(CritterView critter, const Vector2& position, float radius) override;
+
+    // Move a critter that is already in the tree, refreshing its stored centre and radius.  It only changes node
+    // when it leaves its current node's region; returns false (and leaves it out of the tree) if it isn't in the
+    // tree or the position is not finite.
+    bool Update(CritterView critter, const Vector2& newPosition, float radius) override;
+
+    // Take a critter out of the tree; returns false if it wasn't in it.  Its node is queued for MergeUnderfull.
+    bool Remove(CritterView critter) override;
+
+    // Merge every queued sibling group whose items now fit in the parent (cascading upwards)
+    void MergeUnderfull();
+
+    // Call visitor(critter) for every critter whose position lies within a query region, with no intermediate
+    // storage.  The visitor returns true to keep going or false to stop (e.g. for an "any hit?" test); returns false
+    // if the visitor stopped the query early.
+    template <typename Visitor>
+    bool Query(const AABB& range, Visitor&& visitor) const;
 
-    // Insert a critter pointer if within bounds
-    bool Insert(Critter* critter, const Vector2& position);
+    // Visitor version of QueryCircle, with the same early-stop rule as Query
+    template <typename Visitor>
+    bool QueryCircle(const Vector2& centre, float radius, Visitor&& visitor) const;
 
-    // Gather all critters within a query region
-    void Query(const AABB& range, std::vector<Critter*>& outResults) const;
+    // Call visitor(critter, distanceSq) for every critter whose centre is within 'radius' of a point (radii are ignored),
+    // with the same early-stop rule as Query.  Meant for AI neighbour checks; nothing is allocated.
+    template <typename Visitor>
+    bool QueryRadius(const Vector2& point, float radius, Visitor&& visitor) const;
 
-    // Optional: clear and reset the tree
-    void Clear();
+    // The k critters whose centres are nearest a point, written to outNearest (room for k entries) nearest first;
+    // returns how many were found (fewer than k only if the tree holds fewer).  Children are visited closest first and
+    // skipped once they are further than the k-th best so far, which is kept as a max-heap in outNearest itself, so
+    // nothing is allocated.
+    uint32_t QueryKNearest(const Vector2& point, uint32_t k, Neighbour* outNearest) const;
+
+    // Nearest critter whose circle the ray (direction need not be unit length) hits within maxDistance.  Nodes are
+    // walked in ray order and anything beyond the closest hit so far is skipped.  Returns false if nothing was hit.
+    bool RayCast(const Vector2& origin, const Vector2& direction, float maxDistance, RayHit& outHit) const;
+
+    // Every critter the ray hits within maxDistance: visitor(critter, distance) returns true to keep going or false
+    // to stop.  Hits come node by node in ray order, so they are roughly but not strictly sorted by distance.
+    template <typename Visitor>
+    bool RayCastAll(const Vector2& origin, const Vector2& direction, float maxDistance, Visitor&& visitor) const;
+
+    // First critter a circle of 'radius' touches while moving from 'from' to 'to' (e.g. the destroyer along its
+    // velocity this frame); outHit.distance is how far it gets along the way.  Returns false if nothing was hit.
+    bool SweepCircle(const Vector2& from, const Vector2& to, float radius, RayHit& outHit) const;
+
+    // Every critter the moving circle touches, with the same visitor rules as RayCastAll
+    template <typename Visitor>
+    bool SweepCircleAll(const Vector2& from, const Vector2& to, float radius, Visitor&& visitor) const;
+
+    // Gather all critters whose position lies within a query region
+    void Query(const AABB& range, ArenaVector<CritterView>& outResults) const override;
+
+    // Gather all critters whose circle overlaps (or touches) the query circle
+    void QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const override;
+
+    // Every overlapping (or touching) pair once, in a single walk of the tree: pairs within a node, between a node's
+    // items and its descendants, and between sibling subtrees whose loose bounds overlap.  onPair(a, b) is called
+    // with the lower store index first; nothing is allocated.
+    template <typename Callback>
+    void QueryPairs(Callback&& onPair) const;
+
+    // ISpatialIndex version of the above
+    void QueryPairs(PairCallback onPair) const override;
+
+    // Empty the tree in O(1), keeping node and item storage for the next rebuild (or the next round of Inserts)
+    void Clear() override;
+
+    size_t GetNodeCount() const { return m_nodes.size(); }
+
+    // Threads used by the bulk Build; 0 picks the hardware thread count
+    void     SetThreadCount(unsigned threads);
+    unsigned GetThreadCount() const { return m_threads; }
+
+    // Current root region (the constructor's region, or larger once something was inserted outside it)
+    const AABB& GetRegion() const { return m_nodes[0].region; }
 };
+
+inline bool QuadTree::CircleOverlapsRect(const Vector2& centre, float radius, const Rectangle& rect, float margin)
+{
+    const float left = rect.x - margin;
+    const float top = rect.y - margin;
+    const float right = rect.x + rect.width + margin;
+    const float bottom = rect.y + rect.height + margin;
+
+    // Distance from the centre to the closest point of the rectangle
+    const float dx = centre.x < left ? left - centre.x : (centre.x > right ? centre.x - right : 0.0f);
+    const float dy = centre.y < top ? top - centre.y : (centre.y > bottom ? centre.y - bottom : 0.0f);
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+inline uint32_t QuadTree::ChildrenOverlapping(uint32_t firstChild, const Rectangle& range) const
+{
+    const ChildBounds& b = m_childBounds[(firstChild - 1) / 4];
+    const float rangeMaxX = range.x + range.width;
+    const float rangeMaxY = range.y + range.height;
+#if QUADTREE_SSE2
+    const __m128 overlapX = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(b.minX), _mm_set1_ps(rangeMaxX)),
+                                       _mm_cmpgt_ps(_mm_loadu_ps(b.maxX), _mm_set1_ps(range.x)));
+    const __m128 overlapY = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(b.minY), _mm_set1_ps(rangeMaxY)),
+                                       _mm_cmpgt_ps(_mm_loadu_ps(b.maxY), _mm_set1_ps(range.y)));
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_and_ps(overlapX, overlapY)));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (b.minX[i] < rangeMaxX && b.maxX[i] > range.x && b.minY[i] < rangeMaxY && b.maxY[i] > range.y)
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+// Same arithmetic as CircleOverlapsRect, lane by lane: the distance to the grown rectangle on each axis is the larger
+// of (left - x), (x - right) and 0.
+
+inline uint32_t QuadTree::ChildrenNearCircle(uint32_t firstChild, const Vector2& centre, float radius) const
+{
+    const ChildBounds& b = m_childBounds[(firstChild - 1) / 4];
+    const Node* children = &m_nodes[firstChild];
+#if QUADTREE_SSE2
+    const __m128 margin = _mm_setr_ps(children[0].maxRadius, children[1].maxRadius, children[2].maxRadius,
+                                      children[3].maxRadius);
+    const __m128 cx = _mm_set1_ps(centre.x);
+    const __m128 cy = _mm_set1_ps(centre.y);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(b.minX), margin), cx),
+                                            _mm_sub_ps(cx, _mm_add_ps(_mm_loadu_ps(b.maxX), margin))), zero);
+    const __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(b.minY), margin), cy),
+                                            _mm_sub_ps(cy, _mm_add_ps(_mm_loadu_ps(b.maxY), margin))), zero);
+    const __m128 touching = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_set1_ps(radius * radius));
+    return static_cast<uint32_t>(_mm_movemask_ps(touching));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (CircleOverlapsRect(centre, radius, children[i].region.bounds, children[i].maxRadius))
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+inline float QuadTree::DistanceSqToRect(const Vector2& point, const Rectangle& rect)
+{
+    const float right = rect.x + rect.width;
+    const float bottom = rect.y + rect.height;
+    const float dx = point.x < rect.x ? rect.x - point.x : (point.x > right ? point.x - right : 0.0f);
+    const float dy = point.y < rect.y ? rect.y - point.y : (point.y > bottom ? point.y - bottom : 0.0f);
+    return dx * dx + dy * dy;
+}
+
+inline bool QuadTree::LooseOverlap(uint32_t a, uint32_t b) const
+{
+    const Node& na = m_nodes[a];
+    const Node& nb = m_nodes[b];
+    const Rectangle& ra = na.region.bounds;
+    const Rectangle& rb = nb.region.bounds;
+    const float margin = na.maxRadius + nb.maxRadius;
+    return ra.x - margin <= rb.x + rb.width && ra.x + ra.width + margin >= rb.x
+        && ra.y - margin <= rb.y + rb.height && ra.y + ra.height + margin >= rb.y;
+}
+
+#if QUADTREE_SSE2
+// Each Item is one register (x, y, id, radius); pairing the low and high halves and then picking even or odd lanes is a
+// 4x4 transpose without the id row.
+
+inline void QuadTree::LoadItems(const Item* items, __m128& outX, __m128& outY, __m128& outRadius)
+{
+    const __m128 a = _mm_loadu_ps(&items[0].x);
+    const __m128 b = _mm_loadu_ps(&items[1].x);
+    const __m128 c = _mm_loadu_ps(&items[2].x);
+    const __m128 d = _mm_loadu_ps(&items[3].x);
+    const __m128 xyAB = _mm_movelh_ps(a, b);
+    const __m128 xyCD = _mm_movelh_ps(c, d);
+    outX = _mm_shuffle_ps(xyAB, xyCD, _MM_SHUFFLE(2, 0, 2, 0));
+    outY = _mm_shuffle_ps(xyAB, xyCD, _MM_SHUFFLE(3, 1, 3, 1));
+    outRadius = _mm_shuffle_ps(_mm_movehl_ps(b, a), _mm_movehl_ps(d, c), _MM_SHUFFLE(3, 1, 3, 1));
+}
+#endif
+
+// Only the root is tested on its own (AABB::Intersects, inline); every other node was already tested, together with its
+// siblings, by its parent.
+
+template <typename Visitor>
+bool QuadTree::Query(const AABB& range, Visitor&& visitor) const
+{
+    if (!m_nodes[0].region.Intersects(range))
+        return true;
+    return QueryNode(0, range, visitor);
+}
+
+// Items use the inclusive edges of AABB::Contains.  Full groups of four go through SSE2, the rest one at a time.
+
+template <typename Visitor>
+bool QuadTree::QueryNode(uint32_t node, const AABB& range, Visitor& visitor) const
+{
+    const Node& current = m_nodes[node];
+    const Rectangle& bounds = range.bounds;
+    const float maxX = bounds.x + bounds.width;
+    const float maxY = bounds.y + bounds.height;
+
+    // Check points at this node
+    const Item* items = &m_items[current.firstSlot];
+    uint32_t i = 0;
+#if QUADTREE_SSE2
+    if (current.count >= 4) {
+        const __m128 lowX = _mm_set1_ps(bounds.x);
+        const __m128 lowY = _mm_set1_ps(bounds.y);
+        const __m128 highX = _mm_set1_ps(maxX);
+        const __m128 highY = _mm_set1_ps(maxY);
+        for (; i + 4 <= current.count; i += 4) {
+            __m128 x, y, itemRadius;
+            LoadItems(items + i, x, y, itemRadius);
+            const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, lowX), _mm_cmple_ps(x, highX)),
+                                             _mm_and_ps(_mm_cmpge_ps(y, lowY), _mm_cmple_ps(y, highY)));
+            const int mask = _mm_movemask_ps(inside);
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                if ((mask & (1 << lane)) && !visitor(ViewOf(items[i + lane])))
+                    return false;
+            }
+        }
+    }
+#endif
+    for (; i < current.count; ++i) {
+        const Item& item = items[i];
+        if (item.x >= bounds.x && item.x <= maxX && item.y >= bounds.y && item.y <= maxY && !visitor(ViewOf(item)))
+            return false;
+    }
+
+    // If subdivided, query the children whose regions intersect
+    if (current.firstChild != NO_CHILDREN) {
+        const uint32_t mask = ChildrenOverlapping(current.firstChild, bounds);
+        for (uint32_t child = 0; child < 4; ++child) {
+            if ((mask & (1u << child)) && !QueryNode(current.firstChild + child, range, visitor))
+                return false;
+        }
+    }
+    return true;
+}
+
+template <typename Visitor>
+bool QuadTree::QueryCircle(const Vector2& centre, float radius, Visitor&& visitor) const
+{
+    if (!CircleOverlapsRect(centre, radius, m_nodes[0].region.bounds, m_nodes[0].maxRadius))
+        return true;
+    return QueryCircleNode(0, centre, radius, visitor);
+}
+
+// A node can only hold circles that overlap the query if its region, grown by the largest radius below it, does.
+
+template <typename Visitor>
+bool QuadTree::QueryCircleNode(uint32_t node, const Vector2& centre, float radius, Visitor& visitor) const
+{
+    const Node& current = m_nodes[node];
+
+    const Item* items = &m_items[current.firstSlot];
+    uint32_t i = 0;
+#if QUADTREE_SSE2
+    if (current.count >= 4) {
+        const __m128 cx = _mm_set1_ps(centre.x);
+        const __m128 cy = _mm_set1_ps(centre.y);
+        const __m128 r = _mm_set1_ps(radius);
+        for (; i + 4 <= current.count; i += 4) {
+            __m128 x, y, itemRadius;
+            LoadItems(items + i, x, y, itemRadius);
+            const __m128 dx = _mm_sub_ps(x, cx);
+            const __m128 dy = _mm_sub_ps(y, cy);
+            const __m128 reach = _mm_add_ps(r, itemRadius);
+            const __m128 hit = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(reach, reach));
+            const int mask = _mm_movemask_ps(hit);
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                if ((mask & (1 << lane)) && !visitor(ViewOf(items[i + lane])))
+                    return false;
+            }
+        }
+    }
+#endif
+    for (; i < current.count; ++i) {
+        const float dx = items[i].x - centre.x;
+        const float dy = items[i].y - centre.y;
+        const float reach = radius + items[i].radius;
+        if (dx * dx + dy * dy <= reach * reach && !visitor(ViewOf(items[i])))
+            return false;
+    }
+
+    if (current.firstChild != NO_CHILDREN) {
+        const uint32_t mask = ChildrenNearCircle(current.firstChild, centre, radius);
+        for (uint32_t child = 0; child < 4; ++child) {
+            if ((mask & (1u << child)) && !QueryCircleNode(current.firstChild + child, centre, radius, visitor))
+                return false;
+        }
+    }
+    return true;
+}
+
+template <typename Visitor>
+bool QuadTree::QueryRadius(const Vector2& point, float radius, Visitor&& visitor) const
+{
+    return QueryRadiusNode(0, point, radius * radius, visitor);
+}
+
+// Items are placed by their centre, which always lies inside their node's region, so no loose margin is needed here.
+
+template <typename Visitor>
+bool QuadTree::QueryRadiusNode(uint32_t node, const Vector2& point, float radiusSq, Visitor& visitor) const
+{
+    const Node& current = m_nodes[node];
+    if (DistanceSqToRect(point, current.region.bounds) > radiusSq)
+        return true;
+
+    const Item* items = &m_items[current.firstSlot];
+    for (uint32_t i = 0; i < current.count; ++i) {
+        const float dx = items[i].x - point.x;
+        const float dy = items[i].y - point.y;
+        const float distanceSq = dx * dx + dy * dy;
+        if (distanceSq <= radiusSq && !visitor(ViewOf(items[i]), distanceSq))
+            return false;
+    }
+
+    if (current.firstChild != NO_CHILDREN) {
+        for (uint32_t child = current.firstChild; child < current.firstChild + 4; ++child) {
+            if (!QueryRadiusNode(child, point, radiusSq, visitor))
+                return false;
+        }
+    }
+    return true;
+}
+
+inline bool QuadTree::MakeCast(const Vector2& origin, const Vector2& direction, float inflate, Cast& outCast)
+{
+    const float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+    if (length <= 0.0f)
+        return false;
+
+    outCast = Cast{ origin, Vector2{ direction.x / length, direction.y / length }, inflate };
+    return true;
+}
+
+template <typename Visitor>
+bool QuadTree::RayCastAll(const Vector2& origin, const Vector2& direction, float maxDistance, Visitor&& visitor) const
+{
+    Cast cast;
+    if (!MakeCast(origin, direction, 0.0f, cast))
+        return true;
+    return CastNode(0, cast, maxDistance, visitor);
+}
+
+// A sweep that doesn't move is just an overlap test at the start point, so any direction will do.
+
+inline QuadTree::Cast QuadTree::MakeSweep(const Vector2& from, const Vector2& to, float radius, float& outLength)
+{
+    Cast cast;
+    if (!MakeCast(from, Vector2{ to.x - from.x, to.y - from.y }, radius, cast))
+        cast = Cast{ from, Vector2{ 1.0f, 0.0f }, radius };
+
+    const float dx = to.x - from.x;
+    const float dy = to.y - from.y;
+    outLength = std::sqrt(dx * dx + dy * dy);
+    return cast;
+}
+
+template <typename Visitor>
+bool QuadTree::SweepCircleAll(const Vector2& from, const Vector2& to, float radius, Visitor&& visitor) const
+{
+    float length;
+    const Cast cast = MakeSweep(from, to, radius, length);
+    return CastNode(0, cast, length, visitor);
+}
+
+// A node's items can only be hit if the ray enters its region grown by the node's loose margin and the swept radius.
+// Entry distances of the four children are sorted so the nearer ones (and their hits) come first.
+
+template <typename Visitor>
+bool QuadTree::CastNode(uint32_t node, const Cast& cast, float& maxDistance, Visitor& visitor) const
+{
+    const Node& current = m_nodes[node];
+    float enter;
+    if (!RayEntersRect(cast, current.region.bounds, current.maxRadius + cast.inflate, maxDistance, enter))
+        return true;
+
+    const Item* items = &m_items[current.firstSlot];
+    for (uint32_t i = 0; i < current.count; ++i) {
+        float distance;
+        if (RayHitsCircle(cast, Vector2{ items[i].x, items[i].y }, items[i].radius + cast.inflate, maxDistance, distance)
+            && !visitor(ViewOf(items[i]), distance))
+            return false;
+    }
+
+    if (current.firstChild == NO_CHILDREN)
+        return true;
+
+    uint32_t order[4];
+    float entries[4];
+    uint32_t hits = 0;
+    for (uint32_t child = current.firstChild; child < current.firstChild + 4; ++child) {
+        const Node& next = m_nodes[child];
+        if (!RayEntersRect(cast, next.region.bounds, next.maxRadius + cast.inflate, maxDistance, enter))
+            continue;
+
+        uint32_t j = hits++;
+        for (; j > 0 && entries[j - 1] > enter; --j) {
+            entries[j] = entries[j - 1];
+            order[j] = order[j - 1];
+        }
+        entries[j] = enter;
+        order[j] = child;
+    }
+
+    for (uint32_t i = 0; i < hits; ++i) {
+        if (entries[i] > maxDistance)
+            return true;  // The visitor has pulled the limit in past the remaining children
+        if (!CastNode(order[i], cast, maxDistance, visitor))
+            return false;
+    }
+    return true;
+}
+
+// Slab test, clipped to [0, maxDistance].  An axis the ray runs parallel to only needs the origin inside the slab.
+
+inline bool QuadTree::RayEntersRect(const Cast& cast, const Rectangle& rect, float margin, float maxDistance, float& outEnter)
+{
+    float enter = 0.0f;
+    float exit = maxDistance;
+
+    const float origin[2] = { cast.origin.x, cast.origin.y };
+    const float direction[2] = { cast.direction.x, cast.direction.y };
+    const float low[2] = { rect.x - margin, rect.y - margin };
+    const float high[2] = { rect.x + rect.width + margin, rect.y + rect.height + margin };
+    for (int axis = 0; axis < 2; ++axis) {
+        if (direction[axis] == 0.0f) {
+            if (origin[axis] < low[axis] || origin[axis] > high[axis])
+                return false;
+            continue;
+        }
+
+        const float inverse = 1.0f / direction[axis];
+        float first = (low[axis] - origin[axis]) * inverse;
+        float last = (high[axis] - origin[axis]) * inverse;
+        if (first > last)
+            std::swap(first, last);
+        enter = first > enter ? first : enter;
+        exit = last < exit ? last : exit;
+        if (enter > exit)
+            return false;
+    }
+
+    outEnter = enter;
+    return true;
+}
+
+// Solve |origin + t * direction - centre| = radius for the smaller t >= 0 (direction is unit length).
+
+inline bool QuadTree::RayHitsCircle(const Cast& cast, const Vector2& centre, float radius, float maxDistance, float& outDistance)
+{
+    const float mx = cast.origin.x - centre.x;
+    const float my = cast.origin.y - centre.y;
+    const float c = mx * mx + my * my - radius * radius;
+    if (c <= 0.0f) {
+        outDistance = 0.0f;  // Starts inside
+        return true;
+    }
+
+    const float b = mx * cast.direction.x + my * cast.direction.y;
+    if (b >= 0.0f)
+        return false;  // Outside and heading away
+
+    const float discriminant = b * b - c;
+    if (discriminant < 0.0f)
+        return false;
+
+    outDistance = -b - std::sqrt(discriminant);
+    return outDistance <= maxDistance;
+}
+
+template <typename Callback>
+void QuadTree::TestPair(const Item& a, const Item& b, Callback& onPair) const
+{
+    const float dx = b.x - a.x;
+    const float dy = b.y - a.y;
+    const float touch = a.radius + b.radius;
+    if (dx * dx + dy * dy > touch * touch)
+        return;
+
+    if (a.id < b.id)
+        onPair(ViewOf(a), ViewOf(b));
+    else
+        onPair(ViewOf(b), ViewOf(a));
+}
+
+template <typename Callback>
+void QuadTree::QueryPairs(Callback&& onPair) const
+{
+    PairsWithin(0, onPair);
+}
+
+// A pair whose items share a node is tested here; if one item's node is an ancestor of the other's, it is found by the
+// item-vs-subtree walk from the ancestor; otherwise it is found once, by PairsAcross on the two children of the nodes'
+// lowest common ancestor.
+
+template <typename Callback>
+void QuadTree::PairsWithin(uint32_t node, Callback& onPair) const
+{
+    const Node& current = m_nodes[node];
+    const Item* items = &m_items[current.firstSlot];
+
+    // Node-local pairs
+    for (uint32_t i = 0; i < current.count; ++i) {
+        for (uint32_t j = i + 1; j < current.count; ++j)
+            TestPair(items[i], items[j], onPair);
+    }
+
+    if (current.firstChild == NO_CHILDREN)
+        return;
+
+    const uint32_t first = current.firstChild;
+    for (uint32_t child = first; child < first + 4; ++child) {
+        // This node's items against everything below
+        for (uint32_t i = 0; i < current.count; ++i)
+            PairsItemSubtree(items[i], child, onPair);
+        PairsWithin(child, onPair);
+    }
+
+    // Circles near a split line can overlap circles in the neighbouring quadrant
+    for (uint32_t a = first; a < first + 4; ++a) {
+        for (uint32_t b = a + 1; b < first + 4; ++b)
+            PairsAcross(a, b, onPair);
+    }
+}
+
+template <typename Callback>
+void QuadTree::PairsItemSubtree(const Item& item, uint32_t node, Callback& onPair) const
+{
+    const Node& current = m_nodes[node];
+    if (!CircleOverlapsRect(Vector2{ item.x, item.y }, item.radius, current.region.bounds, current.maxRadius))
+        return;
+
+    const Item* items = &m_items[current.firstSlot];
+    for (uint32_t i = 0; i < current.count; ++i)
+        TestPair(item, items[i], onPair);
+
+    if (current.firstChild != NO_CHILDREN) {
+        for (uint32_t child = current.firstChild; child < current.firstChild + 4; ++child)
+            PairsItemSubtree(item, child, onPair);
+    }
+}
+
+// Every item in subtree a against every item in subtree b: a's own items take on all of b, then a's children recurse.
+
+template <typename Callback>
+void QuadTree::PairsAcross(uint32_t a, uint32_t b, Callback& onPair) const
+{
+    if (!LooseOverlap(a, b))
+        return;
+
+    const Node& current = m_nodes[a];
+    const Item* items = &m_items[current.firstSlot];
+    for (uint32_t i = 0; i < current.count; ++i)
+        PairsItemSubtree(items[i], b, onPair);
+
+    if (current.firstChild != NO_CHILDREN) {
+        for (uint32_t child = current.firstChild; child < current.firstChild + 4; ++child)
+            PairsAcross(child, b, onPair);
+    }
+}
@@ -0,0 +1,251 @@
+#include "Simulation.h"
+#include "CritterKernels.h"
+#include "raymath.h"
+
+namespace
+{
+    // CollisionMode::Auto stops using the pair pass once the critters' total area reaches this fraction of the
+    // world's (the crossover measured with --bench index; see README)
+    const float AUTO_PAIRS_MAX_COVERAGE = 1.0f;
+}
+
+Simulation::Simulation(const SimulationConfig& config, Texture2D* destroyerTexture)
+    : m_config(config)
+    , m_spatialIndex(CreateSpatialIndex(config.spatialIndex,
+        AABB{ { 0.0f, 0.0f, config.worldWidth, config.worldHeight } },
+        config.critterRadius * 2.0f))
+    , m_respawnTimerAcc(config.respawnInterval)
+    , m_rng(config.seed)
+{
+    const int width = static_cast<int>(m_config.worldWidth);
+    const int height = static_cast<int>(m_config.worldHeight);
+    std::uniform_int_distribution<int> spawnX(5, width - 6);
+    std::uniform_int_distribution<int> spawnY(5, height - 6);
+
+    // Spawn initial critters
+    m_critters.Reserve(static_cast<size_t>(m_config.critterCount));
+    for (int i = 0; i < m_config.critterCount; ++i)
+    {
+        Vector2 velocity = RandomVelocity();
+        Vector2 position = {
+            static_cast<float>(spawnX(m_rng)),
+            static_cast<float>(spawnY(m_rng))
+        };
+
+        m_critters.Add(position, velocity, m_config.critterRadius);
+    }
+
+    // Create destroyer critter in the centre of the arena
+    m_destroyer.Init({ m_config.worldWidth / 2.0f, m_config.worldHeight / 2.0f },
+        RandomVelocity(),
+        m_config.destroyerRadius,
+        destroyerTexture);
+}
+
+// Pick a random direction and scale it to maxVelocity.  Mirrors the original -100..99 integer spread per axis.
+
+Vector2 Simulation::RandomVelocity()
+{
+    std::uniform_int_distribution<int> spread(-100, 99);
+
+    Vector2 velocity = { 0.0f, 0.0f };
+    while (velocity.x == 0.0f && velocity.y == 0.0f)   // Normalising a zero vector gives NaN
+    {
+        velocity.x = static_cast<float>(spread(m_rng));
+        velocity.y = static_cast<float>(spread(m_rng));
+    }
+    return Vector2Scale(Vector2Normalize(velocity), m_config.maxVelocity);
+}
+
+// Clamp a circle inside the arena accounting for its radius, and flip the velocity on the axis it hit.
+
+void Simulation::BounceOffWalls(Vector2& pos, Vector2& vel, float r) const
+{
+    // Bounce left/right
+    if (pos.x - r < 0.0f)
+    {
+        pos.x = r;
+        vel.x *= -1.0f;
+    }
+    else if (pos.x + r > m_config.worldWidth)
+    {
+        pos.x = m_config.worldWidth - r;
+        vel.x *= -1.0f;
+    }
+    // Bounce top/bottom
+    if (pos.y - r < 0.0f)
+    {
+        pos.y = r;
+        vel.y *= -1.0f;
+    }
+    else if (pos.y + r > m_config.worldHeight)
+    {
+        pos.y = m_config.worldHeight - r;
+        vel.y *= -1.0f;
+    }
+}
+
+void Simulation::Step(float dt)
+{
+    // Release last frame's transient data
+    m_frameArena.Reset();
+
+    UpdateDestroyer(dt);
+    UpdateCritters(dt);
+    UpdateSpatialIndex();
+    ResolveCritterCollisions();
+    Respawn(dt);
+}
+
+void Simulation::UpdateDestroyer(float dt)
+{
+    m_destroyer.Update(dt);
+
+    Vector2 pos = m_destroyer.GetPosition();
+    Vector2 vel = m_destroyer.GetVelocity();
+    BounceOffWalls(pos, vel, m_destroyer.GetRadius());
+    m_destroyer.SetPosition(pos);
+    m_destroyer.SetVelocity(vel);
+}
+
+// Move and bounce every critter with the SIMD kernel, then kill any that touch the destroyer.
+
+void Simulation::UpdateCritters(float dt)
+{
+    const Vector2 destroyerPos = m_destroyer.GetPosition();
+    const float   destroyerRadius = m_destroyer.GetRadius();
+
+    IntegrateAndBounce(m_critters, dt, m_config.worldWidth, m_config.worldHeight);
+    m_critters.ClearAllDirty();
+
+    const uint32_t count = static_cast<uint32_t>(m_critters.Size());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        // Dead critters stay in the store until respawn and must not be killed again
+        if (!m_critters.IsAlive(i))
+            continue;
+
+        // Collision with destroyer?
+        float distToD = Vector2Distance(m_critters.GetPosition(i), destroyerPos);
+        if (distToD < m_critters.GetRadius(i) + destroyerRadius)
+            m_critters.Kill(i);
+    }
+}
+
+// Bring the broadphase in line with this frame's positions, kills and respawns.
+
+void Simulation::UpdateSpatialIndex()
+{
+    m_spatialIndex->Build(m_critters);
+}
+
+// Push a touching pair apart along the line between their centres.  b is skipped if it has already bounced this frame;
+// whether a may have bounced already is up to the caller (see the two paths below).
+
+void Simulation::Bounce(CritterView a, CritterView b)
+{
+    if (b->IsDirty()) return;
+
+    float dist = Vector2Distance(a->GetPosition(), b->GetPosition());
+    if (dist < a->GetRadius() + b->GetRadius())
+    {
+        Vector2 normal = Vector2Normalize(
+            Vector2Subtract(b->GetPosition(), a->GetPosition())
+        );
+        a->SetVelocity(Vector2Scale(normal, -m_config.maxVelocity));
+        b->SetVelocity(Vector2Scale(normal, m_config.maxVelocity));
+        a->SetDirty();
+        b->SetDirty();
+    }
+}
+
+// Broadphase-accelerated critter-critter collisions, through whichever path suits the crowd and the backend.
+
+void Simulation::ResolveCritterCollisions()
+{
+    CollisionMode mode = m_config.collisionMode;
+    if (mode == CollisionMode::Auto)
+    {
+        // The grid and linear quadtree answer QueryPairs with a circle query per critter anyway, so only the trees and
+        // sweep-and-prune gain from the pair pass, and only while most critters aren't touching someone every frame
+        // (total critter area below the world's)
+        const bool pairPass = m_config.spatialIndex == SpatialIndexType::QuadTree
+            || m_config.spatialIndex == SpatialIndexType::SweepAndPrune
+            || m_config.spatialIndex == SpatialIndexType::DynamicAABBTree;
+        const float coverage = static_cast<float>(m_critters.Size()) * PI * m_config.critterRadius * m_config.critterRadius
+            / (m_config.worldWidth * m_config.worldHeight);
+        mode = pairPass && coverage < AUTO_PAIRS_MAX_COVERAGE ? CollisionMode::Pairs : CollisionMode::PerCritter;
+    }
+
+    if (mode == CollisionMode::Pairs)
+        ResolveCollisionPairs();
+    else
+        ResolveCollisionsPerCritter();
+}
+
+// One QueryPairs pass reports every touching pair once (a per-critter query sees each pair from both sides), and each
+// pair is resolved inside the callback, so nothing is buffered.  A pair is skipped if either critter has already
+// bounced, so every critter bounces at most once.  This is not the same contact set as the per-critter path: pairs
+// arrive in the index's traversal order rather than critter by critter, and there a critter may keep bouncing off
+// neighbours during its own turn.
+
+void Simulation::ResolveCollisionPairs()
+{
+    auto bounce = [this](CritterView a, CritterView b)
+    {
+        if (!a->IsDirty())
+            Bounce(a, b);
+    };
+    m_spatialIndex->QueryPairs(bounce);
+}
+
+// The original rule: a circle query with the critter's own radius returns every critter it touches (the index adds each
+// neighbour's radius), and the critter bounces off each one that hasn't bounced yet, keeping the last push.  Critters
+// that had already bounced when their turn came are skipped without a query, which is what makes this path cheaper in
+// a saturated crowd: the pair pass has to enumerate every contact regardless.
+
+void Simulation::ResolveCollisionsPerCritter()
+{
+    const uint32_t count = static_cast<uint32_t>(m_critters.Size());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        CritterView a = m_critters.Get(i);
+        if (a->IsDead() || a->IsDirty()) continue;
+
+        ArenaVector<CritterView> neighbours{ ArenaAllocator<CritterView>(&m_frameArena) };
+        m_spatialIndex->QueryCircle(a->GetPosition(), a->GetRadius(), neighbours);
+
+        for (CritterView b : neighbours)
+        {
+            if (b != a)
+                Bounce(a, b);
+        }
+    }
+}
+
+// Every respawnInterval seconds bring one dead critter back behind the destroyer, moving away from it.
+
+void Simulation::Respawn(float dt)
+{
+    m_respawnTimerAcc -= dt;
+    if (m_respawnTimerAcc > 0.0f)
+        return;
+
+    m_respawnTimerAcc = m_config.respawnInterval;
+    const uint32_t count = static_cast<uint32_t>(m_critters.Size());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!m_critters.IsAlive(i))
+        {
+            Vector2 dir = Vector2Normalize(m_destroyer.GetVelocity());
+            Vector2 spawnPos = Vector2Subtract(
+                m_destroyer.GetPosition(),
+                Vector2Scale(dir, 50.0f)
+            );
+            m_critters.Reset(i, spawnPos,
+                Vector2Scale(dir, -m_config.maxVelocity),
+                m_config.critterRadius);
+            break;
+        }
+    }
+}
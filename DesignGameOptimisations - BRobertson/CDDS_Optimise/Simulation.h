@@ -0,0 +1,83 @@
+#pragma once
+#include "raylib.h"
+#include "Critter.h"
+#include "CritterStore.h"
+#include "FrameArena.h"
+#include "SpatialIndex.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+// How critter-critter contacts are found each frame
+enum class CollisionMode
+{
+    Auto,        // Pairs for ordinary crowds on backends with a one-pass QueryPairs, otherwise PerCritter
+    Pairs,       // One ISpatialIndex::QueryPairs pass; each critter bounces at most once (a different contact set)
+    PerCritter   // The original rule: a QueryCircle per critter that hasn't bounced yet this frame
+};
+
+// Tunable values for a simulation run
+struct SimulationConfig
+{
+    float        worldWidth = 800.0f;    // Arena size in world-space
+    float        worldHeight = 450.0f;
+    int          critterCount = 50;      // Number of critter slots
+    float        maxVelocity = 80.0f;    // Speed of every critter and the destroyer
+    float        respawnInterval = 1.0f; // Seconds between respawns
+    float        critterRadius = 12.0f;
+    float        destroyerRadius = 20.0f;
+    unsigned int seed = 0;               // Random seed for spawn positions/velocities
+    SpatialIndexType spatialIndex = SpatialIndexType::QuadTree;  // Broadphase backend for critter collisions
+    CollisionMode    collisionMode = CollisionMode::Auto;
+};
+
+// Game state and per-frame update, independent of the window and renderer.
+// The windowed build draws from the accessors below; the headless build only calls Step.
+
+class Simulation
+{
+private:
+    SimulationConfig       m_config;
+
+    CritterStore           m_critters;          // Contiguous SoA storage for every critter
+    Critter                m_destroyer;
+
+    FrameArena             m_frameArena;        // Transient per-frame data, reset at the start of Step
+    std::unique_ptr<ISpatialIndex> m_spatialIndex;   // Broadphase chosen by config.spatialIndex, kept across frames
+    float                  m_respawnTimerAcc;   // Counts down to the next respawn
+
+    std::mt19937           m_rng;
+
+    // Random direction scaled to maxVelocity
+    Vector2 RandomVelocity();
+
+    // Keep a circle inside the arena, reflecting its velocity off the walls
+    void BounceOffWalls(Vector2& pos, Vector2& vel, float r) const;
+
+    // Simulation phases, run in this order by Step
+    void UpdateDestroyer(float dt);
+    void UpdateCritters(float dt);
+    void UpdateSpatialIndex();
+    void ResolveCritterCollisions();
+    void Respawn(float dt);
+
+    // ResolveCritterCollisions paths, and the bounce they share
+    void ResolveCollisionPairs();
+    void ResolveCollisionsPerCritter();
+    void Bounce(CritterView a, CritterView b);
+
+public:
+    // destroyerTexture may be null when running headless
+    Simulation(const SimulationConfig& config, Texture2D* destroyerTexture = nullptr);
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Advance the world by dt seconds
+    void Step(float dt);
+
+    const SimulationConfig& GetConfig() const { return m_config; }
+
+    CritterStore& GetCritters() { return m_critters; }
+    Critter&      GetDestroyer() { return m_destroyer; }
+};
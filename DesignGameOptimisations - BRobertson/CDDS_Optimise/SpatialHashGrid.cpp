@@ -0,0 +1,231 @@
+#include "SpatialHashGrid.h"
+#include <algorithm>
+#include <cmath>
+
+const uint32_t SpatialHashGrid::NONE;  // Bound to a const reference by vector::resize
+
+SpatialHashGrid::SpatialHashGrid(const AABB& world, float cellSize)
+    : m_cellSize(cellSize > 0.0f ? cellSize : 1.0f)
+    , m_inverseCellSize(1.0f / m_cellSize)
+    , m_store(nullptr)
+    , m_maxRadius(0.0f)
+{
+    const float cellsX = std::ceil(world.bounds.width * m_inverseCellSize);
+    const float cellsY = std::ceil(world.bounds.height * m_inverseCellSize);
+    const double cells = static_cast<double>(cellsX) * static_cast<double>(cellsY);
+
+    uint32_t buckets = 64;
+    while (buckets < cells && buckets < (1u << 24))
+        buckets <<= 1;
+
+    m_bucketMask = buckets - 1;
+    m_buckets.assign(buckets, NONE);
+}
+
+int32_t SpatialHashGrid::CellOf(float coordinate) const
+{
+    return static_cast<int32_t>(std::floor(coordinate * m_inverseCellSize));
+}
+
+// Multiply each coordinate by a large odd constant and mix, so neighbouring cells land in different buckets.
+
+uint32_t SpatialHashGrid::BucketOf(int32_t cellX, int32_t cellY) const
+{
+    const uint32_t h = static_cast<uint32_t>(cellX) * 0x8DA6B343u ^ static_cast<uint32_t>(cellY) * 0xD8163841u;
+    return (h ^ (h >> 16)) & m_bucketMask;
+}
+
+void SpatialHashGrid::Reserve(uint32_t index)
+{
+    if (index < m_bucketOf.size())
+        return;
+
+    const size_t size = static_cast<size_t>(index) + 1;
+    m_bucketOf.resize(size, NONE);
+    m_next.resize(size, NONE);
+    m_previous.resize(size, NONE);
+    m_cellX.resize(size, 0);
+    m_cellY.resize(size, 0);
+    m_x.resize(size, 0.0f);
+    m_y.resize(size, 0.0f);
+    m_radius.resize(size, 0.0f);
+}
+
+void SpatialHashGrid::Link(uint32_t index, uint32_t bucket)
+{
+    const uint32_t head = m_buckets[bucket];
+    m_next[index] = head;
+    m_previous[index] = NONE;
+    if (head != NONE)
+        m_previous[head] = index;
+    m_buckets[bucket] = index;
+    m_bucketOf[index] = bucket;
+}
+
+void SpatialHashGrid::Unlink(uint32_t index)
+{
+    const uint32_t next = m_next[index];
+    const uint32_t previous = m_previous[index];
+    if (previous != NONE)
+        m_next[previous] = next;
+    else
+        m_buckets[m_bucketOf[index]] = next;
+    if (next != NONE)
+        m_previous[next] = previous;
+    m_bucketOf[index] = NONE;
+}
+
+// Walk the bucket of every cell in the range.  Critters from other cells that share a bucket are skipped by comparing
+// their stored cell, which also stops a bucket being reported twice when two cells of the range hash to it.
+
+template <typename Visitor>
+void SpatialHashGrid::VisitCells(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, Visitor visit) const
+{
+    for (int32_t y = minY; y <= maxY; ++y)
+    {
+        for (int32_t x = minX; x <= maxX; ++x)
+        {
+            for (uint32_t index = m_buckets[BucketOf(x, y)]; index != NONE; index = m_next[index])
+            {
+                if (m_cellX[index] == x && m_cellY[index] == y)
+                    visit(index);
+            }
+        }
+    }
+}
+
+void SpatialHashGrid::Build(CritterStore& critters)
+{
+    Clear();
+    m_store = &critters;
+
+    const uint32_t count = static_cast<uint32_t>(critters.Size());
+    if (count > 0)
+        Reserve(count - 1);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (critters.IsAlive(i))
+            Insert(critters.Get(i), critters.GetPosition(i), critters.GetRadius(i));
+    }
+}
+
+// Re-inserting a critter that is already in the grid just moves it.
+
+bool SpatialHashGrid::Insert(CritterView critter, const Vector2& position, float radius)
+{
+    const uint32_t index = critter.GetIndex();
+    Reserve(index);
+    m_store = critter.GetStore();
+
+    if (m_bucketOf[index] != NONE)
+        Unlink(index);
+
+    m_cellX[index] = CellOf(position.x);
+    m_cellY[index] = CellOf(position.y);
+    m_x[index] = position.x;
+    m_y[index] = position.y;
+    m_radius[index] = radius;
+    m_maxRadius = std::max(m_maxRadius, radius);
+    Link(index, BucketOf(m_cellX[index], m_cellY[index]));
+    return true;
+}
+
+// Only relinks when the critter changes cell; the stored centre is refreshed either way.
+
+bool SpatialHashGrid::Update(CritterView critter, const Vector2& position, float radius)
+{
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_bucketOf.size() || m_bucketOf[index] == NONE)
+        return false;
+
+    m_x[index] = position.x;
+    m_y[index] = position.y;
+    m_radius[index] = radius;
+    m_maxRadius = std::max(m_maxRadius, radius);
+
+    const int32_t cellX = CellOf(position.x);
+    const int32_t cellY = CellOf(position.y);
+    if (cellX == m_cellX[index] && cellY == m_cellY[index])
+        return true;
+
+    Unlink(index);
+    m_cellX[index] = cellX;
+    m_cellY[index] = cellY;
+    Link(index, BucketOf(cellX, cellY));
+    return true;
+}
+
+bool SpatialHashGrid::Remove(CritterView critter)
+{
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_bucketOf.size() || m_bucketOf[index] == NONE)
+        return false;
+
+    Unlink(index);
+    return true;
+}
+
+void SpatialHashGrid::Query(const AABB& range, ArenaVector<CritterView>& outResults) const
+{
+    const Rectangle& r = range.bounds;
+    VisitCells(CellOf(r.x), CellOf(r.y), CellOf(r.x + r.width), CellOf(r.y + r.height),
+        [&](uint32_t index)
+        {
+            const Vector2 p{ m_x[index], m_y[index] };
+            if (p.x >= r.x && p.x <= r.x + r.width && p.y >= r.y && p.y <= r.y + r.height)
+                outResults.push_back(m_store->Get(index));
+        });
+}
+
+// Critters are placed by centre, so the cells to visit are the query circle grown by the largest radius.
+
+void SpatialHashGrid::QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const
+{
+    const float reach = radius + m_maxRadius;
+    VisitCells(CellOf(centre.x - reach), CellOf(centre.y - reach), CellOf(centre.x + reach), CellOf(centre.y + reach),
+        [&](uint32_t index)
+        {
+            const Vector2 p{ m_x[index], m_y[index] };
+            const float dx = p.x - centre.x;
+            const float dy = p.y - centre.y;
+            const float touch = radius + m_radius[index];
+            if (dx * dx + dy * dy <= touch * touch)
+                outResults.push_back(m_store->Get(index));
+        });
+}
+
+// A circle query around each critter, keeping only partners with a higher index so each pair is reported once.
+
+void SpatialHashGrid::QueryPairs(PairCallback onPair) const
+{
+    const uint32_t count = static_cast<uint32_t>(m_bucketOf.size());
+    for (uint32_t a = 0; a < count; ++a)
+    {
+        if (m_bucketOf[a] == NONE)
+            continue;
+
+        const Vector2 centre{ m_x[a], m_y[a] };
+        const float radius = m_radius[a];
+        const float reach = radius + m_maxRadius;
+        VisitCells(CellOf(centre.x - reach), CellOf(centre.y - reach), CellOf(centre.x + reach), CellOf(centre.y + reach),
+            [&](uint32_t b)
+            {
+                if (b <= a)
+                    return;
+
+                const Vector2 p{ m_x[b], m_y[b] };
+                const float dx = p.x - centre.x;
+                const float dy = p.y - centre.y;
+                const float touch = radius + m_radius[b];
+                if (dx * dx + dy * dy <= touch * touch)
+                    onPair(m_store->Get(a), m_store->Get(b));
+            });
+    }
+}
+
+void SpatialHashGrid::Clear()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), NONE);
+    std::fill(m_bucketOf.begin(), m_bucketOf.end(), NONE);
+    m_maxRadius = 0.0f;
+}
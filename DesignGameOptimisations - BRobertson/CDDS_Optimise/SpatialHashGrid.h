@@ -0,0 +1,70 @@
+#pragma once
+#include "SpatialIndex.h"
+#include <cstdint>
+#include <vector>
+
+// Uniform grid broadphase, hashed so it needs no fixed bounds.
+//
+// Space is cut into square cells (about twice the critter radius, so a collision query only touches a
+// 3x3 block) and each cell is hashed into a power-of-two bucket table.  Every bucket is an intrusive
+// doubly-linked list threaded through per-critter arrays indexed by store index, so Insert, Update and
+// Remove are O(1) and nothing is allocated once the arrays have grown to the store size.  Each item
+// remembers its cell, which filters out other cells that happen to share a bucket, and the centre it
+// was placed with, so queries test the same positions the cells were picked from.
+
+class SpatialHashGrid : public ISpatialIndex
+{
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+    float                 m_cellSize;
+    float                 m_inverseCellSize;
+    uint32_t              m_bucketMask;       // Bucket count - 1
+    std::vector<uint32_t> m_buckets;          // First critter index in each bucket, or NONE
+
+    // Per critter, indexed by store index
+    std::vector<uint32_t> m_bucketOf;         // Bucket holding the critter, or NONE if not in the grid
+    std::vector<uint32_t> m_next;             // Bucket list links
+    std::vector<uint32_t> m_previous;
+    std::vector<int32_t>  m_cellX;            // Cell the critter was placed in
+    std::vector<int32_t>  m_cellY;
+    std::vector<float>    m_x;                // Centre given at the last Insert/Update
+    std::vector<float>    m_y;
+    std::vector<float>    m_radius;
+
+    CritterStore*         m_store;            // Store the indexed critters belong to
+    float                 m_maxRadius;        // Largest radius inserted since the last Clear (query margin)
+
+    int32_t  CellOf(float coordinate) const;
+    uint32_t BucketOf(int32_t cellX, int32_t cellY) const;
+
+    // Grow the per-critter arrays to hold 'index'
+    void Reserve(uint32_t index);
+
+    void Link(uint32_t index, uint32_t bucket);
+    void Unlink(uint32_t index);
+
+    // Call visit(index) for every critter placed in a cell within the given cell range
+    template <typename Visitor>
+    void VisitCells(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, Visitor visit) const;
+
+public:
+    // 'world' sizes the bucket table (one bucket per cell, rounded up to a power of two); positions
+    // outside it are still accepted.
+    SpatialHashGrid(const AABB& world, float cellSize);
+
+    // Clear and re-insert every live critter
+    void Build(CritterStore& critters) override;
+
+    bool Insert(CritterView critter, const Vector2& position, float radius) override;
+    bool Update(CritterView critter, const Vector2& position, float radius) override;
+    bool Remove(CritterView critter) override;
+
+    void Query(const AABB& range, ArenaVector<CritterView>& outResults) const override;
+    void QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const override;
+    void QueryPairs(PairCallback onPair) const override;
+
+    void Clear() override;
+
+    float GetCellSize() const { return m_cellSize; }
+};
@@ -0,0 +1,52 @@
+#include "SpatialIndex.h"
+#include "DynamicAABBTree.h"
+#include "LinearQuadTree.h"
+#include "QuadTree.h"
+#include "SpatialHashGrid.h"
+#include "SweepAndPrune.h"
+#include <cstring>
+
+namespace
+{
+    // Indexed by SpatialIndexType
+    const char* const SPATIAL_INDEX_NAMES[] = { "quadtree", "grid", "sap", "linear", "bvh" };
+    static_assert(sizeof(SPATIAL_INDEX_NAMES) / sizeof(SPATIAL_INDEX_NAMES[0]) == static_cast<size_t>(SpatialIndexType::Count),
+        "Every SpatialIndexType needs a name");
+}
+
+std::unique_ptr<ISpatialIndex> CreateSpatialIndex(SpatialIndexType type, const AABB& world, float cellSize)
+{
+    switch (type)
+    {
+    case SpatialIndexType::SpatialHashGrid:
+        return std::unique_ptr<ISpatialIndex>(new SpatialHashGrid(world, cellSize));
+    case SpatialIndexType::SweepAndPrune:
+        return std::unique_ptr<ISpatialIndex>(new SweepAndPrune(world));
+    case SpatialIndexType::LinearQuadTree:
+        return std::unique_ptr<ISpatialIndex>(new LinearQuadTree(world));
+    case SpatialIndexType::DynamicAABBTree:
+        return std::unique_ptr<ISpatialIndex>(new DynamicAABBTree());
+    case SpatialIndexType::QuadTree:
+    default:
+        return std::unique_ptr<ISpatialIndex>(new QuadTree(world));
+    }
+}
+
+const char* GetSpatialIndexName(SpatialIndexType type)
+{
+    const size_t index = static_cast<size_t>(type);
+    return index < static_cast<size_t>(SpatialIndexType::Count) ? SPATIAL_INDEX_NAMES[index] : "unknown";
+}
+
+bool ParseSpatialIndexType(const char* name, SpatialIndexType& outType)
+{
+    for (size_t i = 0; i < static_cast<size_t>(SpatialIndexType::Count); ++i)
+    {
+        if (std::strcmp(name, SPATIAL_INDEX_NAMES[i]) == 0)
+        {
+            outType = static_cast<SpatialIndexType>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "raylib.h"
+#include "CritterStore.h"
+#include "FrameArena.h"
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// Axis‐aligned rectangle for region queries.  The tests are written out inline (same results as raylib's
+// CheckCollisionPointRec/CheckCollisionRecs) so the headless core never calls into the raylib library and the
+// QuadTree's hot paths can inline them.  The QuadTree's SSE2 item and child tests use the same edge rules.
+
+struct AABB {
+    Rectangle bounds;
+    // Check if a point lies within this box; points on an edge count as inside
+    bool Contains(const Vector2& point) const {
+        return point.x >= bounds.x && point.x <= bounds.x + bounds.width
+            && point.y >= bounds.y && point.y <= bounds.y + bounds.height;
+    }
+    // Check if two boxes intersect; boxes that only share an edge don't
+    bool Intersects(const AABB& other) const {
+        const Rectangle& o = other.bounds;
+        return bounds.x < o.x + o.width && bounds.x + bounds.width > o.x
+            && bounds.y < o.y + o.height && bounds.y + bounds.height > o.y;
+    }
+};
+
+// Non-owning reference to a caller's pair handler, anything callable as onPair(CritterView a, CritterView b).
+// Lets the virtual QueryPairs call straight into a lambda (one indirect call per pair) without std::function's
+// allocation or a buffer of pairs in between.  The handler must outlive the QueryPairs call.
+class PairCallback
+{
+private:
+    void* m_handler;
+    void (*m_invoke)(void* handler, CritterView a, CritterView b);
+
+    template <typename Handler>
+    static void Invoke(void* handler, CritterView a, CritterView b)
+    {
+        (*static_cast<Handler*>(handler))(a, b);
+    }
+
+public:
+    template <typename Handler,
+              typename = typename std::enable_if<!std::is_same<typename std::decay<Handler>::type, PairCallback>::value>::type>
+    PairCallback(Handler& handler)
+        : m_handler(const_cast<void*>(static_cast<const void*>(&handler)))   // Invoke restores any const
+        , m_invoke(&Invoke<Handler>)
+    {
+    }
+
+    void operator()(CritterView a, CritterView b) const { m_invoke(m_handler, a, b); }
+};
+
+// Broadphase used by the simulation.  Critters are indexed as circles and identified by their index
+// in one CritterStore; the collision code only talks to this interface, so backends can be swapped
+// per scenario.
+
+class ISpatialIndex
+{
+public:
+    virtual ~ISpatialIndex() = default;
+
+    // Bring the index in line with every live critter in the store (positions and radii as they are now).
+    // Backends are free to rebuild from scratch or update incrementally.
+    virtual void Build(CritterStore& critters) = 0;
+
+    // Add one critter; returns false if the backend can't hold that position
+    virtual bool Insert(CritterView critter, const Vector2& position, float radius) = 0;
+
+    // Move a critter already in the index; returns false if it isn't in it (or can't be placed)
+    virtual bool Update(CritterView critter, const Vector2& position, float radius) = 0;
+
+    // Take a critter out; returns false if it wasn't in it
+    virtual bool Remove(CritterView critter) = 0;
+
+    // Gather all critters whose position lies within a region
+    virtual void Query(const AABB& range, ArenaVector<CritterView>& outResults) const = 0;
+
+    // Gather all critters whose circle overlaps (or touches) the query circle
+    virtual void QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const = 0;
+
+    // Call onPair(a, b) once for every pair of overlapping (or touching) critters, lower store index first.
+    // The handler may change critter velocities and flags but must not move critters or touch the index.
+    virtual void QueryPairs(PairCallback onPair) const = 0;
+
+    // Remove everything
+    virtual void Clear() = 0;
+};
+
+// Available backends, chosen through SimulationConfig
+enum class SpatialIndexType
+{
+    QuadTree,
+    SpatialHashGrid,
+    SweepAndPrune,
+    LinearQuadTree,
+    DynamicAABBTree,
+    Count
+};
+
+// Create a backend covering 'world'.  cellSize is a hint for grid-like backends (about twice the typical radius).
+std::unique_ptr<ISpatialIndex> CreateSpatialIndex(SpatialIndexType type, const AABB& world, float cellSize);
+
+// Command-line name of a backend ("quadtree", "grid", "sap", "linear", "bvh"), and the reverse; Parse returns false for unknown names
+const char* GetSpatialIndexName(SpatialIndexType type);
+bool        ParseSpatialIndexType(const char* name, SpatialIndexType& outType);
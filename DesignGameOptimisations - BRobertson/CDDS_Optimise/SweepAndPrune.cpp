@@ -0,0 +1,246 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+const uint32_t SweepAndPrune::NONE;  // Bound to a const reference by vector::resize
+
+SweepAndPrune::SweepAndPrune(const AABB& world)
+    : m_axis(world.bounds.width >= world.bounds.height ? 0 : 1)
+    , m_store(nullptr)
+    , m_tombstones(0)
+    , m_maxRadius(0.0f)
+{
+}
+
+void SweepAndPrune::SetEntry(Entry& entry, uint32_t index, const Vector2& position, float radius)
+{
+    const float centre = AxisOf(position);
+    entry.min = centre - radius;
+    entry.max = centre + radius;
+    entry.x = position.x;
+    entry.y = position.y;
+    entry.radius = radius;
+    entry.index = index;
+    m_maxRadius = std::max(m_maxRadius, radius);
+}
+
+// Critters move a pixel or two per frame, so this usually swaps with zero or one neighbour.
+
+void SweepAndPrune::Sift(uint32_t position)
+{
+    const Entry moving = m_entries[position];
+
+    while (position > 0 && m_entries[position - 1].min > moving.min)
+    {
+        m_entries[position] = m_entries[position - 1];
+        if (m_entries[position].index != NONE)
+            m_entryOf[m_entries[position].index] = position;
+        --position;
+    }
+    while (position + 1 < m_entries.size() && m_entries[position + 1].min < moving.min)
+    {
+        m_entries[position] = m_entries[position + 1];
+        if (m_entries[position].index != NONE)
+            m_entryOf[m_entries[position].index] = position;
+        ++position;
+    }
+
+    m_entries[position] = moving;
+    m_entryOf[moving.index] = position;
+}
+
+uint32_t SweepAndPrune::LowerBound(float value) const
+{
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), value,
+        [](const Entry& entry, float v) { return entry.min < v; });
+    return static_cast<uint32_t>(it - m_entries.begin());
+}
+
+void SweepAndPrune::SortAll()
+{
+    std::sort(m_entries.begin(), m_entries.end(),
+        [](const Entry& a, const Entry& b) { return a.min < b.min; });
+    for (uint32_t i = 0; i < m_entries.size(); ++i)
+        m_entryOf[m_entries[i].index] = i;
+}
+
+// Removing entries never disturbs the order of the rest, so one forward pass is enough.
+
+void SweepAndPrune::Compact()
+{
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < m_entries.size(); ++i)
+    {
+        if (m_entries[i].index == NONE)
+            continue;
+        m_entries[kept] = m_entries[i];
+        m_entryOf[m_entries[kept].index] = kept;
+        ++kept;
+    }
+    m_entries.resize(kept);
+    m_tombstones = 0;
+}
+
+void SweepAndPrune::Build(CritterStore& critters)
+{
+    m_store = &critters;
+    const uint32_t count = static_cast<uint32_t>(critters.Size());
+    if (m_entryOf.size() < count)
+        m_entryOf.resize(count, NONE);
+
+    // Nothing to be coherent with yet: append everything and sort once instead of n insertion steps
+    if (m_entries.empty())
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (!critters.IsAlive(i))
+                continue;
+            m_entries.push_back(Entry());
+            SetEntry(m_entries.back(), i, critters.GetPosition(i), critters.GetRadius(i));
+        }
+        SortAll();
+        return;
+    }
+
+    // SetEntry only ever raises m_maxRadius, so measure the live critters afresh as we go
+    float maxRadius = 0.0f;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        CritterView critter = critters.Get(i);
+        if (!critters.IsAlive(i))
+        {
+            Remove(critter);
+            continue;
+        }
+
+        const Vector2 position = critters.GetPosition(i);
+        const float radius = critters.GetRadius(i);
+        if (!Update(critter, position, radius))
+            Insert(critter, position, radius);
+        maxRadius = std::max(maxRadius, radius);
+    }
+
+    if (m_tombstones > 0)
+        Compact();
+    m_maxRadius = maxRadius;
+}
+
+// Append and slide into place.  Inserting a critter that is already present just moves it.
+
+bool SweepAndPrune::Insert(CritterView critter, const Vector2& position, float radius)
+{
+    if (Update(critter, position, radius))
+        return true;
+
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_entryOf.size())
+        m_entryOf.resize(index + 1, NONE);
+    m_store = critter.GetStore();
+
+    m_entries.push_back(Entry());
+    SetEntry(m_entries.back(), index, position, radius);
+    Sift(static_cast<uint32_t>(m_entries.size() - 1));
+    return true;
+}
+
+bool SweepAndPrune::Update(CritterView critter, const Vector2& position, float radius)
+{
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_entryOf.size() || m_entryOf[index] == NONE)
+        return false;
+
+    const uint32_t at = m_entryOf[index];
+    SetEntry(m_entries[at], index, position, radius);
+    Sift(at);
+    return true;
+}
+
+bool SweepAndPrune::Remove(CritterView critter)
+{
+    const uint32_t index = critter.GetIndex();
+    if (index >= m_entryOf.size() || m_entryOf[index] == NONE)
+        return false;
+
+    // The interval stays behind so the array is still sorted for Sift and the queries' early exits
+    m_entries[m_entryOf[index]].index = NONE;
+    m_entryOf[index] = NONE;
+    ++m_tombstones;
+    return true;
+}
+
+// A centre inside the range has its interval start no earlier than range - maxRadius, so the scan begins there.
+
+void SweepAndPrune::Query(const AABB& range, ArenaVector<CritterView>& outResults) const
+{
+    const Rectangle& r = range.bounds;
+    const float low = m_axis == 0 ? r.x : r.y;
+    const float high = low + (m_axis == 0 ? r.width : r.height);
+
+    for (uint32_t i = LowerBound(low - m_maxRadius); i < m_entries.size() && m_entries[i].min <= high; ++i)
+    {
+        const Entry& e = m_entries[i];
+        if (e.index == NONE)
+            continue;
+        if (e.x >= r.x && e.x <= r.x + r.width && e.y >= r.y && e.y <= r.y + r.height)
+            outResults.push_back(m_store->Get(e.index));
+    }
+}
+
+// Intervals are at most 2 * maxRadius long, so any that reaches the query starts within that distance before it.
+
+void SweepAndPrune::QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const
+{
+    const float along = AxisOf(centre);
+    for (uint32_t i = LowerBound(along - radius - 2.0f * m_maxRadius);
+         i < m_entries.size() && m_entries[i].min <= along + radius; ++i)
+    {
+        const Entry& e = m_entries[i];
+        if (e.index == NONE)
+            continue;
+        const float dx = e.x - centre.x;
+        const float dy = e.y - centre.y;
+        const float touch = radius + e.radius;
+        if (dx * dx + dy * dy <= touch * touch)
+            outResults.push_back(m_store->Get(e.index));
+    }
+}
+
+// The sweep: each entry is only compared with later entries whose interval starts before it ends.
+
+void SweepAndPrune::QueryPairs(PairCallback onPair) const
+{
+    const size_t count = m_entries.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Entry& a = m_entries[i];
+        if (a.index == NONE)
+            continue;
+        for (size_t j = i + 1; j < count && m_entries[j].min <= a.max; ++j)
+        {
+            const Entry& b = m_entries[j];
+            if (b.index == NONE)
+                continue;
+            const float dx = b.x - a.x;
+            const float dy = b.y - a.y;
+            const float touch = a.radius + b.radius;
+            if (dx * dx + dy * dy > touch * touch)
+                continue;
+
+            if (a.index < b.index)
+                onPair(m_store->Get(a.index), m_store->Get(b.index));
+            else
+                onPair(m_store->Get(b.index), m_store->Get(a.index));
+        }
+    }
+}
+
+void SweepAndPrune::Clear()
+{
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.index != NONE)
+            m_entryOf[entry.index] = NONE;
+    }
+    m_entries.clear();
+    m_tombstones = 0;
+    m_maxRadius = 0.0f;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "SpatialIndex.h"
+#include <cstdint>
+#include <vector>
+
+// Sort-and-sweep broadphase that relies on frame-to-frame coherence.
+//
+// Every critter is an interval [x - r, x + r] on one axis (the world's longer side), kept in an array
+// sorted by its lower endpoint.  The array persists across frames: Update rewrites an entry in place
+// and slides it left or right until the order holds again, so a whole frame of small moves is an
+// insertion sort costing close to O(n).  QueryPairs sweeps the array once, testing each entry only
+// against the following entries whose intervals start before it ends.  Entries carry their own
+// position and radius so the sweep never leaves the array.
+//
+// Remove leaves a tombstone (index NONE) where the entry was rather than closing the gap, so a kill
+// is O(1); the tombstone keeps its interval so the array stays sorted, queries step over it, and the
+// next Build squeezes all of them out in one pass.
+
+class SweepAndPrune : public ISpatialIndex
+{
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+    struct Entry
+    {
+        float    min;      // Interval on the sort axis
+        float    max;
+        float    x;        // Centre captured at Insert/Update
+        float    y;
+        float    radius;
+        uint32_t index;    // Critter index in the store, or NONE for a removed entry
+    };
+
+    int                   m_axis;        // 0 = sort on x, 1 = sort on y
+    std::vector<Entry>    m_entries;     // Sorted by min, tombstones included
+    std::vector<uint32_t> m_entryOf;     // Critter index -> position in m_entries, or NONE
+    CritterStore*         m_store;
+    uint32_t              m_tombstones;  // Removed entries still sitting in m_entries
+    float                 m_maxRadius;   // Largest live radius as of the last Build, raised by Insert/Update
+
+    float AxisOf(const Vector2& position) const { return m_axis == 0 ? position.x : position.y; }
+
+    // Fill an entry from a position and radius
+    void SetEntry(Entry& entry, uint32_t index, const Vector2& position, float radius);
+
+    // Slide the entry at 'position' to its sorted place (one insertion-sort step)
+    void Sift(uint32_t position);
+
+    // First entry whose min is >= value
+    uint32_t LowerBound(float value) const;
+
+    // Sort everything in one go and rebuild m_entryOf (used when building from empty)
+    void SortAll();
+
+    // Drop the tombstones, keeping the survivors in order, and rebuild m_entryOf
+    void Compact();
+
+public:
+    // Sorts along the longer side of 'world', where critters are spread out the most
+    explicit SweepAndPrune(const AABB& world);
+
+    // Update, insert or remove every critter to match the store; the first Build sorts from scratch.
+    // Also compacts away tombstones and shrinks m_maxRadius back to the largest live radius.
+    void Build(CritterStore& critters) override;
+
+    bool Insert(CritterView critter, const Vector2& position, float radius) override;
+    bool Update(CritterView critter, const Vector2& position, float radius) override;
+
+    // O(1): leaves a tombstone for the next Build to compact
+    bool Remove(CritterView critter) override;
+
+    void Query(const AABB& range, ArenaVector<CritterView>& outResults) const override;
+    void QueryCircle(const Vector2& centre, float radius, ArenaVector<CritterView>& outResults) const override;
+    void QueryPairs(PairCallback onPair) const override;
+
+    void Clear() override;
+};
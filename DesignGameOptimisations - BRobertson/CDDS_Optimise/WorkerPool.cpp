@@ -0,0 +1,83 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool()
+    : m_job(nullptr)
+    , m_context(nullptr)
+    , m_generation(0)
+    , m_participants(0)
+    , m_pending(0)
+    , m_stop(false)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+}
+
+// Workers that aren't needed for a job just note its generation and go back to sleep.
+
+void WorkerPool::WorkerLoop(unsigned worker, uint64_t seen)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+        if (m_stop)
+            return;
+
+        seen = m_generation;
+        if (worker >= m_participants)
+            continue;
+
+        void (*job)(void*, unsigned) = m_job;
+        void* context = m_context;
+        lock.unlock();
+        job(context, worker + 1);
+        lock.lock();
+
+        if (--m_pending == 0)
+            m_done.notify_one();
+    }
+}
+
+// Only the owner posts jobs and it waits for each to finish, so m_generation can't move while new workers start and
+// they can be handed its current value directly.
+
+void WorkerPool::RunJob(unsigned threads, void (*job)(void* context, unsigned thread), void* context)
+{
+    if (threads <= 1)
+    {
+        job(context, 0);
+        return;
+    }
+
+    const unsigned helpers = threads - 1;
+    if (m_workers.size() < helpers)
+    {
+        m_workers.reserve(helpers);
+        for (unsigned w = static_cast<unsigned>(m_workers.size()); w < helpers; ++w)
+            m_workers.emplace_back(&WorkerPool::WorkerLoop, this, w, m_generation);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = job;
+        m_context = context;
+        m_participants = helpers;
+        m_pending = helpers;
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    job(context, 0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent helper threads for the parallel tree builds.
+//
+// Run(threads, job) calls job(t) once for every t in [0, threads): t = 0 on the calling thread and the
+// rest on pool workers, then waits for all of them.  Workers are started the first time a job needs
+// them and afterwards sleep on a condition variable between jobs, so a rebuild every frame costs two
+// wake-ups per worker instead of creating and joining threads.  One job runs at a time; Run is meant
+// to be called from the pool's owner only.
+
+class WorkerPool
+{
+private:
+    std::vector<std::thread> m_workers;    // Worker w runs job index w + 1
+    std::mutex               m_mutex;
+    std::condition_variable  m_wake;       // Signalled when a job is posted or the pool shuts down
+    std::condition_variable  m_done;       // Signalled when the last worker finishes a job
+
+    void    (*m_job)(void* context, unsigned thread);
+    void*     m_context;
+    uint64_t  m_generation;   // Bumped for every posted job, so a worker never runs the same job twice
+    unsigned  m_participants; // Workers taking part in the current job (the first m_participants)
+    unsigned  m_pending;      // Of those, how many are still running it
+    bool      m_stop;
+
+    // 'seen' is the generation at start-up; only later jobs are picked up
+    void WorkerLoop(unsigned worker, uint64_t seen);
+
+    // Type-erased body of Run
+    void RunJob(unsigned threads, void (*job)(void* context, unsigned thread), void* context);
+
+    template <typename Job>
+    static void Invoke(void* context, unsigned thread)
+    {
+        (*static_cast<Job*>(context))(thread);
+    }
+
+public:
+    WorkerPool();
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Call job(t) for t in [0, threads) across the calling thread and threads - 1 workers, returning once all are done
+    template <typename Job>
+    void Run(unsigned threads, Job& job)
+    {
+        RunJob(threads, &Invoke<Job>, &job);
+    }
+
+    // Workers started so far
+    size_t GetWorkerCount() const { return m_workers.size(); }
+};
@@ -1,252 +1,150 @@
 ﻿#include "raylib.h"
-#include "raymath.h"
-#include <random>
 #include <time.h>
 #include "Critter.h"
-#include "ObjectPool.h"
 #include "TextureManager.h"
-#include "QuadTree.h"
+#include "Simulation.h"
+#include "Benchmarks.h"
+#include "AllocationCounter.h"
 #include <iostream>
 #include <chrono>
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
 
-int main(int argc, char* argv[])
+// Read a broadphase name into the config, listing the valid names if it isn't one
+static bool ParseIndexArgument(const char* name, SimulationConfig& config)
+{
+    if (ParseSpatialIndexType(name, config.spatialIndex))
+        return true;
+
+    std::cerr << "Unknown spatial index '" << name << "'. Available:";
+    for (int i = 0; i < static_cast<int>(SpatialIndexType::Count); ++i)
+        std::cerr << " " << GetSpatialIndexName(static_cast<SpatialIndexType>(i));
+    std::cerr << std::endl;
+    return false;
+}
+
+// Draw a critter if it's active.  DrawTexture expects an int position, cast for pixel-perfect placement.
+static void DrawCritter(const Critter& critter)
 {
+    if (critter.IsDead() || critter.GetTexture() == nullptr)
+        return;
 
-    // Initialise window & timing
+    DrawTexture(*critter.GetTexture(),
+        static_cast<int>(critter.GetX()),
+        static_cast<int>(critter.GetY()),
+        WHITE);  // WHITE is a Raylib colour constant
+}
 
-    const int screenWidth = 800;
-    const int screenHeight = 450;
-    InitWindow(screenWidth, screenHeight, "Design Game Optimised BRobertson");
-    
-    // Seed random number generator
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));
+// Draw every live critter in the store with one shared texture
+static void DrawCritters(const CritterStore& critters, const Texture2D& texture)
+{
+    const uint32_t count = static_cast<uint32_t>(critters.Size());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!critters.IsAlive(i))
+            continue;
 
-    // Constants & managers
- 
-    const int  CRITTER_COUNT = 50;
-    const float MAX_VELOCITY = 80.0f;
-    const float RESPAWN_INTERVAL = 1.0f;
+        DrawTexture(texture,
+            static_cast<int>(critters.GetX(i)),
+            static_cast<int>(critters.GetY(i)),
+            WHITE);
+    }
+}
 
-    TextureManager textureManager;
-    Texture2D* critterTexture = textureManager.LoadTexture("res/10.png");
-    Texture2D* destroyerTexture = textureManager.LoadTexture("res/9.png");
+// Run the simulation without a window for a fixed number of frames and report timings.
+// Usage: CDDS_Optimise --headless [frames] [critters] [index]
 
-    // Pool to recycle Critter objects
-    ObjectPool<Critter> critterPool(CRITTER_COUNT);
-    Critter* critters[CRITTER_COUNT] = {};
+static int RunHeadless(int argc, char* argv[])
+{
+    const int   frames = argc > 2 ? std::atoi(argv[2]) : 10000;
+    const float dt = 1.0f / 60.0f;   // Fixed step so runs are repeatable
 
-   
-    // Spawn initial critters
+    SimulationConfig config;
+    config.seed = 1234u;
+    if (argc > 3)
+        config.critterCount = std::atoi(argv[3]);
+    if (argc > 4 && !ParseIndexArgument(argv[4], config))
+        return 1;
 
-    for (int i = 0; i < CRITTER_COUNT; ++i)
-    {
-        critters[i] = critterPool.Get();
+    Simulation simulation(config);
 
-        Vector2 velocity = {
-            -100.0f + static_cast<float>(rand() % 200),
-            -100.0f + static_cast<float>(rand() % 200)
-        };
-        velocity = Vector2Scale(Vector2Normalize(velocity), MAX_VELOCITY);
+#if defined(COUNT_HEAP_ALLOCATIONS)
+    const int warmUpFrames = frames < 60 ? frames : 60;   // Let arenas and containers reach full size
+    size_t allocationsAfterWarmUp = 0;
+#endif
 
-        Vector2 position = {
-            static_cast<float>(5 + rand() % (screenWidth - 10)),
-            static_cast<float>(5 + rand() % (screenHeight - 10))
-        };
-
-        critters[i]->Init(position, velocity, 12.0f, critterTexture);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+#if defined(COUNT_HEAP_ALLOCATIONS)
+        if (frame == warmUpFrames)
+            allocationsAfterWarmUp = GetHeapAllocationCount();
+#endif
+        simulation.Step(dt);
     }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << "Index: " << GetSpatialIndexName(config.spatialIndex)
+              << ", Critters: " << config.critterCount
+              << ", Frames: " << frames
+              << ", Total: " << totalMs << " ms"
+              << ", Step: " << (frames > 0 ? totalMs / frames : 0.0) << " ms"
+              << ", Heap allocations after warm-up: ";
+#if defined(COUNT_HEAP_ALLOCATIONS)
+    std::cout << (frames > warmUpFrames ? GetHeapAllocationCount() - allocationsAfterWarmUp : 0) << std::endl;
+#else
+    std::cout << "not counted (build with COUNT_HEAP_ALLOCATIONS)" << std::endl;
+#endif
+    return 0;
+}
 
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && std::strcmp(argv[1], "--headless") == 0)
+        return RunHeadless(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+        return RunBenchmark(argc, argv);
 
-    // Create destroyer critter
-
-    Critter destroyer;
-    Vector2 dVel = {
-        -100.0f + static_cast<float>(rand() % 200),
-        -100.0f + static_cast<float>(rand() % 200)
-    };
-    dVel = Vector2Scale(Vector2Normalize(dVel), MAX_VELOCITY);
-    destroyer.Init({ screenWidth / 2.0f, screenHeight / 2.0f },
-        dVel,
-        20.0f,
-        destroyerTexture);
+    // Optional broadphase choice for the windowed game: CDDS_Optimise --index <name>
+    SimulationConfig config;
+    if (argc > 2 && std::strcmp(argv[1], "--index") == 0 && !ParseIndexArgument(argv[2], config))
+        return 1;
 
-    // Respawn timer accumulator
-    float respawnTimerAcc = RESPAWN_INTERVAL;
+    // Initialise window & timing
 
-    // Predefine quadtree world region (screen bounds)
-    static const AABB worldRegion{ {0.0f, 0.0f,
-                                   static_cast<float>(screenWidth),
-                                   static_cast<float>(screenHeight)} };
+    const int screenWidth = 800;
+    const int screenHeight = 450;
+    InitWindow(screenWidth, screenHeight, "Design Game Optimised BRobertson");
 
+    TextureManager textureManager;
+    Texture2D* critterTexture = textureManager.LoadTexture("res/10.png");
+    Texture2D* destroyerTexture = textureManager.LoadTexture("res/9.png");
 
-    // Create quadtree once and reuse each frame
+    config.worldWidth = static_cast<float>(screenWidth);
+    config.worldHeight = static_cast<float>(screenHeight);
+    config.seed = static_cast<unsigned int>(std::time(nullptr));
 
-    QuadTree quadTree(worldRegion);
+    Simulation simulation(config, destroyerTexture);
 
     // Main game loop
 
     while (!WindowShouldClose())
     {
-        // Clear the quadtree for this frame to avoid reallocating nodes
-        quadTree.Clear();
-
-        // Calculate delta time
-        float dt = GetFrameTime();
-
-        // --- Update destroyer movement & bouncing ---
-        destroyer.Update(dt);
-        Vector2 dPos = destroyer.GetPosition();
-        Vector2 dVelCurr = destroyer.GetVelocity();
-        float   dr = destroyer.GetRadius();
-
-        // Bounce left/right accounting for radius
-        if (dPos.x - dr < 0.0f)
-        {
-            dPos.x = dr;
-            dVelCurr.x *= -1.0f;
-        }
-        else if (dPos.x + dr > screenWidth)
-        {
-            dPos.x = screenWidth - dr;
-            dVelCurr.x *= -1.0f;
-        }
-        // Bounce top/bottom accounting for radius
-        if (dPos.y - dr < 0.0f)
-        {
-            dPos.y = dr;
-            dVelCurr.y *= -1.0f;
-        }
-        else if (dPos.y + dr > screenHeight)
-        {
-            dPos.y = screenHeight - dr;
-            dVelCurr.y *= -1.0f;
-        }
-        destroyer.SetPosition(dPos);
-        destroyer.SetVelocity(dVelCurr);
-
-        // --- Update critters & handle destroyer collisions ---
-        for (int i = 0; i < CRITTER_COUNT; ++i)
-        {
-            Critter* c = critters[i];
-            c->Update(dt);
-
-            Vector2 pos = c->GetPosition();
-            Vector2 vel = c->GetVelocity();
-            float   r = c->GetRadius();
-
-            // Bounce left/right
-            if (pos.x - r < 0.0f)
-            {
-                pos.x = r;
-                vel.x *= -1.0f;
-            }
-            else if (pos.x + r > screenWidth)
-            {
-                pos.x = screenWidth - r;
-                vel.x *= -1.0f;
-            }
-            // Bounce top/bottom
-            if (pos.y - r < 0.0f)
-            {
-                pos.y = r;
-                vel.y *= -1.0f;
-            }
-            else if (pos.y + r > screenHeight)
-            {
-                pos.y = screenHeight - r;
-                vel.y *= -1.0f;
-            }
-
-            c->SetPosition(pos);
-            c->SetVelocity(vel);
-
-            // Collision with destroyer?
-            float distToD = Vector2Distance(pos, destroyer.GetPosition());
-            if (distToD < r + destroyer.GetRadius())
-            {
-                c->Destroy();
-                critterPool.Return(c);
-            }
-        }
-
-        // --- Insert critters into re-used quadtree ---
-        for (int i = 0; i < CRITTER_COUNT; ++i)
-        {
-            Critter* c = critters[i];
-            if (!c->IsDead())
-                quadTree.Insert(c, c->GetPosition());
-        }
-
-        // --- Quadtree-accelerated critter–critter collisions ---
-        for (int i = 0; i < CRITTER_COUNT; ++i)
-        {
-            Critter* a = critters[i];
-            if (a->IsDead() || a->IsDirty()) continue;
-
-            float range = a->GetRadius() * 2.0f;
-            AABB  queryBox{ { a->GetX() - range / 2.0f,
-                             a->GetY() - range / 2.0f,
-                             range, range} };
-            std::vector<Critter*> neighbours;
-            quadTree.Query(queryBox, neighbours);
-
-            for (Critter* b : neighbours)
-            {
-                if (b == a || b->IsDirty()) continue;
-                float dist = Vector2Distance(a->GetPosition(), b->GetPosition());
-                if (dist < a->GetRadius() + b->GetRadius())
-                {
-                    Vector2 normal = Vector2Normalize(
-                        Vector2Subtract(b->GetPosition(), a->GetPosition())
-                    );
-                    a->SetVelocity(Vector2Scale(normal, -MAX_VELOCITY));
-                    b->SetVelocity(Vector2Scale(normal, MAX_VELOCITY));
-                    a->SetDirty();
-                    b->SetDirty();
-                }
-            }
-        }
-
-        // --- Respawn logic ---
-        respawnTimerAcc -= dt;
-        if (respawnTimerAcc <= 0.0f)
-        {
-            respawnTimerAcc = RESPAWN_INTERVAL;
-            for (int i = 0; i < CRITTER_COUNT; ++i)
-            {
-                Critter* c = critters[i];
-                if (c->IsDead())
-                {
-                    Vector2 dir = Vector2Normalize(destroyer.GetVelocity());
-                    Vector2 spawnPos = Vector2Subtract(
-                        destroyer.GetPosition(),
-                        Vector2Scale(dir, 50.0f)
-                    );
-                    c->Reset(spawnPos,
-                        Vector2Scale(dir, -MAX_VELOCITY),
-                        12.0f,
-                        critterTexture);
-                    break;
-                }
-            }
-        }
+        simulation.Step(GetFrameTime());
 
         // --- Draw ---
         BeginDrawing();
         ClearBackground(RAYWHITE);
-        for (int i = 0; i < CRITTER_COUNT; ++i)
-            critters[i]->Draw();
-        destroyer.Draw();
+        DrawCritters(simulation.GetCritters(), *critterTexture);
+        DrawCritter(simulation.GetDestroyer());
         DrawFPS(10, 10);
         EndDrawing();
     }
 
     // Cleanup
-    for (int i = 0; i < CRITTER_COUNT; ++i)
-        critters[i]->Destroy();
     textureManager.UnloadAllTextures();
     CloseWindow();
 
     return 0;
-}
\ No newline at end of file
+}